@@ -0,0 +1,245 @@
+#pragma once
+#include "sort.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Settings for external_sort
+struct external_sort_options {
+	// Upper bound on the bytes held by sort and merge buffers at any one time
+	std::size_t memory_limit = std::size_t(256) << 20;
+
+	// Directory that sorted runs are spilled into, the system temp directory if empty
+	std::string temp_dir;
+
+	// Smallest read buffer given to each run being merged, so every refill is one large sequential read
+	// More runs than the memory limit has room for at this size are merged over several passes.
+	std::size_t min_buffer_bytes = std::size_t(256) << 10;
+
+	// Most runs merged at once, which keeps the open files well under the usual per-process limit
+	std::size_t max_fan_in = 256;
+};
+
+// Binary file of raw T records opened for large sequential reads or writes
+// Buffering is done by the caller in big blocks, so stdio's own buffer is turned off.
+struct external_file {
+	external_file(const std::string& path, const char* mode) : file(std::fopen(path.c_str(), mode)) {
+		if (!file)
+			throw std::runtime_error("Could not open " + path);
+		std::setvbuf(file, nullptr, _IONBF, 0);
+	}
+	external_file(const external_file& other) = delete;
+	void operator=(const external_file& other) = delete;
+	external_file(external_file&& other) noexcept : file(std::exchange(other.file, nullptr)) {}
+	~external_file() {
+		if (file)
+			std::fclose(file);
+	}
+
+	// Reads up to [count] records, returns how many were read
+	template <typename T>
+	std::size_t read(T* out, const std::size_t count) {
+		const std::size_t got = std::fread(out, sizeof(T), count, file);
+		if (got < count && std::ferror(file))
+			throw std::runtime_error("Failed reading records");
+		return got;
+	}
+
+	template <typename T>
+	void write(const T* in, const std::size_t count) {
+		if (count && std::fwrite(in, sizeof(T), count, file) != count)
+			throw std::runtime_error("Failed writing records");
+	}
+
+	std::FILE* file;
+};
+
+// Sorted run on disk, read back one buffer at a time during the merge
+template <typename T>
+struct external_run {
+	external_run(const std::string& path, const std::size_t buffer_count) : file(path, "rb"), buffer(buffer_count) {
+		refill();
+	}
+
+	bool exhausted() const noexcept { return pos == len; }
+	const T& front() const { return buffer[pos]; }
+
+	// Moves onto the next record, reading the next block once the buffer runs out
+	void pop() {
+		if (++pos == len)
+			refill();
+	}
+private:
+	void refill() {
+		len = file.read(buffer.data(), buffer.size());
+		pos = 0;
+	}
+	external_file file;
+	std::vector<T> buffer;
+	std::size_t pos = 0, len = 0;
+};
+
+// Tournament tree over k sorted runs, each internal node holds the loser of the match played there
+// The overall winner is kept at the top, so replacing it takes one walk from leaf to root.
+// Takes O(log k) comparisons per record.
+template <typename T>
+struct loser_tree {
+	loser_tree(std::vector<external_run<T>>& sources) : runs(sources), k(sources.size()), tree(sources.size()) {
+		// Play every match bottom up once, the leaves of run i sit at k + i
+		std::vector<std::size_t> winners(2 * k);
+		for (std::size_t i = 0; i < k; ++i)
+			winners[k + i] = i;
+		for (std::size_t node = k - 1; node > 0; --node) {
+			const std::size_t left = winners[2 * node], right = winners[2 * node + 1];
+			const bool right_wins = beats(right, left);
+			winners[node] = right_wins ? right : left;
+			tree[node] = right_wins ? left : right;
+		}
+		tree[0] = (k > 1) ? winners[1] : 0;
+	}
+
+	// Run holding the smallest remaining record
+	std::size_t top() const noexcept { return tree[0]; }
+
+	// Whether every run has been used up
+	bool empty() const { return runs[tree[0]].exhausted(); }
+
+	// Replays the matches on the path of the winning run after its front record was popped
+	void replay() {
+		std::size_t winner = tree[0];
+		for (std::size_t node = (k + winner) / 2; node > 0; node /= 2)
+			if (beats(tree[node], winner))
+				std::swap(tree[node], winner);
+		tree[0] = winner;
+	}
+private:
+	// Whether run a's front record comes before run b's, with exhausted runs losing every match
+	bool beats(const std::size_t a, const std::size_t b) const {
+		if (runs[a].exhausted())
+			return false;
+		if (runs[b].exhausted())
+			return true;
+		return radix_traits<T>::to_bits(runs[a].front()) < radix_traits<T>::to_bits(runs[b].front());
+	}
+	std::vector<external_run<T>>& runs;
+	std::size_t k;
+	std::vector<std::size_t> tree;
+};
+
+// Merges [count] sorted run files into [out] through a loser tree, reading and writing [buffer_count] records at a time
+// Takes O(n log count) time.
+template <typename T>
+void merge_external_runs(const std::string* paths, const std::size_t count, external_file& out, const std::size_t buffer_count) {
+	std::vector<external_run<T>> sources;
+	sources.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		sources.emplace_back(paths[i], buffer_count);
+
+	loser_tree<T> tree(sources);
+	std::vector<T> buffer;
+	buffer.reserve(buffer_count);
+	while (!tree.empty()) {
+		auto& run = sources[tree.top()];
+		buffer.push_back(run.front());
+		run.pop();
+		tree.replay();
+		if (buffer.size() == buffer_count) {
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	}
+	out.write(buffer.data(), buffer.size());
+}
+
+// Sorts a binary file of raw T records that may be larger than memory into [output]
+// Chunks of the input that fit in the memory limit are radix sorted and spilled to temporary run files,
+// which are then k-way merged through a loser tree with large sequential reads and writes.
+// When there are more runs than fit in one merge, groups of them are first merged into longer runs.
+// Inputs that fit in a single chunk are sorted in memory and written straight out.
+// Takes O(n log k) time for k runs, reading and writing the data twice plus once more per extra merge pass.
+template <typename T>
+void external_sort(const std::string& input, const std::string& output, const external_sort_options& options = {}) {
+	static_assert(std::is_trivially_copyable<T>::value, "Records are read and written as raw bytes");
+	static_assert(is_radix_key_fn<T, radix_identity>::value, "Records must be integer or IEEE float keys");
+
+	// Radix sort needs a scratch buffer as large as the chunk, so a chunk gets half the budget
+	const std::size_t chunk_count = std::max<std::size_t>(options.memory_limit / (2 * sizeof(T)), 1);
+
+	namespace fs = std::filesystem;
+	const fs::path temp_dir = options.temp_dir.empty() ? fs::temp_directory_path() : fs::path(options.temp_dir);
+	const std::string prefix = "external_sort_" + std::to_string(std::random_device{}()) + "_";
+
+	// Removes the spilled runs however the sort ends
+	struct run_files {
+		std::vector<std::string> paths;
+		// Number for the next run's file name
+		std::size_t next = 0;
+		~run_files() {
+			std::error_code ignored;
+			for (const auto& path : paths)
+				fs::remove(path, ignored);
+		}
+	} runs;
+
+	//// Split the input into sorted runs
+	{
+		external_file in(input, "rb");
+		std::vector<T> chunk(chunk_count);
+		while (true) {
+			chunk.resize(chunk_count);
+			chunk.resize(in.read(chunk.data(), chunk_count));
+			if (chunk.empty())
+				break;
+			radix_sort(chunk);
+
+			// The whole input fit in one chunk, so skip the spill and merge
+			if (runs.paths.empty() && chunk.size() < chunk_count) {
+				external_file out(output, "wb");
+				out.write(chunk.data(), chunk.size());
+				return;
+			}
+
+			runs.paths.push_back((temp_dir / (prefix + std::to_string(runs.next++) + ".run")).string());
+			external_file(runs.paths.back(), "wb").write(chunk.data(), chunk.size());
+		}
+	}
+
+	//// Merge the runs, at most fan_in at a time
+	// The budget is shared between one buffer per run and the output buffer, each at least min_buffer_bytes.
+	const std::size_t min_buffer = std::max<std::size_t>(options.min_buffer_bytes, sizeof(T));
+	const std::size_t fan_in = std::min(std::max<std::size_t>(options.max_fan_in, 2),
+		std::max<std::size_t>(options.memory_limit / min_buffer, 3) - 1);
+	const std::size_t buffer_count = std::max(options.memory_limit / (fan_in + 1), min_buffer) / sizeof(T);
+
+	// Earlier passes merge groups of runs into longer intermediate runs until one final pass is left
+	std::vector<std::string> level = runs.paths;
+	while (level.size() > fan_in) {
+		std::vector<std::string> merged;
+		for (std::size_t first = 0; first < level.size(); first += fan_in) {
+			const std::size_t count = std::min(fan_in, level.size() - first);
+			// A group of one is already a sorted run
+			if (count == 1) {
+				merged.push_back(level[first]);
+				continue;
+			}
+			runs.paths.push_back((temp_dir / (prefix + std::to_string(runs.next++) + ".run")).string());
+			merged.push_back(runs.paths.back());
+			{
+				external_file out(merged.back(), "wb");
+				merge_external_runs<T>(level.data() + first, count, out, buffer_count);
+			}
+			// The merged runs aren't needed again, so free their disk space straight away
+			std::error_code ignored;
+			for (std::size_t i = first; i < first + count; ++i)
+				fs::remove(level[i], ignored);
+		}
+		level = std::move(merged);
+	}
+
+	external_file out(output, "wb");
+	if (!level.empty())
+		merge_external_runs<T>(level.data(), level.size(), out, buffer_count);
+}
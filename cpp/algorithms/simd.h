@@ -0,0 +1,371 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+// Vector kernels are built with GCC and Clang vector extensions, one copy per instruction set, picked at runtime
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PZ_HAS_SIMD 1
+#define PZ_SIMD_INLINE __attribute__((always_inline)) inline
+#else
+#define PZ_HAS_SIMD 0
+#define PZ_SIMD_INLINE inline
+#endif
+
+// Bulk kernels over arrays of numbers
+// Each kernel is compiled for SSE2, AVX2 and AVX-512 as well as plain scalar code,
+// and calls go to the widest instruction set the processor supports.
+namespace pz::simd {
+	// Instruction sets the kernels can run with, narrowest first
+	enum class isa { scalar, sse2, avx2, avx512 };
+
+	// Element types the kernels vectorise
+	template <typename T>
+	struct supported : std::bool_constant<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value
+		&& !std::is_same<T, long double>::value> {};
+
+	// Returns the widest instruction set this processor supports
+	inline isa detect() noexcept {
+#if PZ_HAS_SIMD
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+			return isa::avx512;
+		if (__builtin_cpu_supports("avx2"))
+			return isa::avx2;
+		if (__builtin_cpu_supports("sse2"))
+			return isa::sse2;
+#endif
+		return isa::scalar;
+	}
+
+	// Instruction set calls currently go to, detected once at startup
+	inline isa selected = detect();
+
+	// Returns the instruction set the kernels currently run with
+	inline isa active() noexcept { return selected; }
+
+	// Restricts the kernels to [level] or narrower, e.g. to compare against scalar code
+	// Levels the processor doesn't support are clamped to what it does. Not thread safe, set it before starting threads.
+	inline void use(const isa level) noexcept { selected = std::min(level, detect()); }
+
+	// Type sums are accumulated in, unsigned for integers so overflow wraps rather than being undefined
+	template <typename T>
+	using sum_lane = typename std::conditional_t<std::is_integral<T>::value, std::make_unsigned<T>, std::common_type<T>>::type;
+
+#if PZ_HAS_SIMD
+	// Vector of [Bytes] bytes of T
+	// Only aligned like T and allowed to alias it, so vectors can be read and written at any element, like _mm256_loadu.
+	template <std::size_t Bytes, typename T>
+	struct vector_of {
+		typedef T type __attribute__((vector_size(Bytes), aligned(alignof(T)), may_alias));
+	};
+
+	// Vectors are passed by reference, as passing wide vectors by value depends on the instruction set
+	template <typename V, typename T>
+	PZ_SIMD_INLINE const V& load(const T* from) { return *reinterpret_cast<const V*>(from); }
+	template <typename V, typename T>
+	PZ_SIMD_INLINE void store(T* to, const V& v) { *reinterpret_cast<V*>(to) = v; }
+
+	// Runs a kernel's vector code compiled for each instruction set
+	// The kernel body is always inlined, so it is compiled with the wrapper's instruction set.
+	template <typename Kernel, typename... Args>
+	__attribute__((target("avx512f,avx512bw,avx512vl"), flatten)) auto run_avx512(Args&... args) { return Kernel::template run<64>(args...); }
+	template <typename Kernel, typename... Args>
+	__attribute__((target("avx2"), flatten)) auto run_avx2(Args&... args) { return Kernel::template run<32>(args...); }
+#endif
+
+	// Calls [Kernel] with the widest instruction set selected, or its scalar code
+	template <typename Kernel, typename... Args>
+	auto dispatch(Args... args) {
+#if PZ_HAS_SIMD
+		switch (active()) {
+		case isa::avx512:
+			return run_avx512<Kernel>(args...);
+		case isa::avx2:
+			return run_avx2<Kernel>(args...);
+		case isa::sse2:
+			return Kernel::template run<16>(args...);
+		default:
+			break;
+		}
+#endif
+		return Kernel::scalar(args...);
+	}
+
+	//// Kernels
+	// Each has run<Bytes>, the loop over vectors of that many bytes, and scalar, the loop for everything else.
+	// Loops that reduce keep four accumulators so consecutive vectors don't wait on each other.
+
+	struct fill_kernel {
+		template <typename T>
+		static int scalar(T* out, const std::size_t n, const T value) {
+			for (std::size_t i = 0; i < n; ++i)
+				out[i] = value;
+			return 0;
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T>
+		PZ_SIMD_INLINE static int run(T* out, const std::size_t n, const T value) {
+			using V = typename vector_of<Bytes, T>::type;
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			const V v = V{} + value;
+			std::size_t i = 0;
+			for (; i + lanes <= n; i += lanes)
+				store(out + i, v);
+			return scalar(out + i, n - i, value);
+		}
+#endif
+	};
+
+	struct copy_kernel {
+		template <typename T>
+		static int scalar(T* out, const T* in, const std::size_t n) {
+			for (std::size_t i = 0; i < n; ++i)
+				out[i] = in[i];
+			return 0;
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T>
+		PZ_SIMD_INLINE static int run(T* out, const T* in, const std::size_t n) {
+			using V = typename vector_of<Bytes, T>::type;
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			std::size_t i = 0;
+			for (; i + 4 * lanes <= n; i += 4 * lanes) {
+				const V a = load<V>(in + i), b = load<V>(in + i + lanes), c = load<V>(in + i + 2 * lanes), d = load<V>(in + i + 3 * lanes);
+				store(out + i, a);
+				store(out + i + lanes, b);
+				store(out + i + 2 * lanes, c);
+				store(out + i + 3 * lanes, d);
+			}
+			return scalar(out + i, in + i, n - i);
+		}
+#endif
+	};
+
+	struct sum_kernel {
+		template <typename T>
+		static T scalar(const T* in, const std::size_t n) {
+			sum_lane<T> total = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				total += sum_lane<T>(in[i]);
+			return T(total);
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T>
+		PZ_SIMD_INLINE static T run(const T* in, const std::size_t n) {
+			using V = typename vector_of<Bytes, sum_lane<T>>::type;
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			V acc[4] = {};
+			std::size_t i = 0;
+			for (; i + 4 * lanes <= n; i += 4 * lanes)
+				for (std::size_t k = 0; k < 4; ++k)
+					acc[k] += load<V>(in + i + k * lanes);
+			for (; i + lanes <= n; i += lanes)
+				acc[0] += load<V>(in + i);
+			const V folded = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+			sum_lane<T> total = sum_lane<T>(scalar(in + i, n - i));
+			for (std::size_t l = 0; l < lanes; ++l)
+				total += folded[l];
+			return T(total);
+		}
+#endif
+	};
+
+	struct dot_kernel {
+		template <typename T>
+		static T scalar(const T* a, const T* b, const std::size_t n) {
+			// At least unsigned int, so narrow unsigned types aren't promoted to int and overflow it
+			using wide = std::common_type_t<sum_lane<T>, unsigned int>;
+			sum_lane<T> total = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				total += sum_lane<T>(wide(a[i]) * wide(b[i]));
+			return T(total);
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T>
+		PZ_SIMD_INLINE static T run(const T* a, const T* b, const std::size_t n) {
+			using V = typename vector_of<Bytes, sum_lane<T>>::type;
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			V acc[4] = {};
+			std::size_t i = 0;
+			for (; i + 4 * lanes <= n; i += 4 * lanes)
+				for (std::size_t k = 0; k < 4; ++k)
+					acc[k] += load<V>(a + i + k * lanes) * load<V>(b + i + k * lanes);
+			for (; i + lanes <= n; i += lanes)
+				acc[0] += load<V>(a + i) * load<V>(b + i);
+			const V folded = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+			sum_lane<T> total = sum_lane<T>(scalar(a + i, b + i, n - i));
+			for (std::size_t l = 0; l < lanes; ++l)
+				total += folded[l];
+			return T(total);
+		}
+#endif
+	};
+
+	struct min_max_kernel {
+		template <typename T>
+		static std::pair<T, T> scalar(const T* in, const std::size_t n) {
+			std::pair<T, T> result(std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest());
+			for (std::size_t i = 0; i < n; ++i) {
+				result.first = (in[i] < result.first) ? in[i] : result.first;
+				result.second = (in[i] > result.second) ? in[i] : result.second;
+			}
+			return result;
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T>
+		PZ_SIMD_INLINE static std::pair<T, T> run(const T* in, const std::size_t n) {
+			using V = typename vector_of<Bytes, T>::type;
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			if (n < lanes)
+				return scalar(in, n);
+			V low[2], high[2];
+			low[0] = low[1] = high[0] = high[1] = load<V>(in);
+			std::size_t i = lanes;
+			for (; i + 2 * lanes <= n; i += 2 * lanes)
+				for (std::size_t k = 0; k < 2; ++k) {
+					const V v = load<V>(in + i + k * lanes);
+					low[k] = (v < low[k]) ? v : low[k];
+					high[k] = (v > high[k]) ? v : high[k];
+				}
+			for (; i + lanes <= n; i += lanes) {
+				const V v = load<V>(in + i);
+				low[0] = (v < low[0]) ? v : low[0];
+				high[0] = (v > high[0]) ? v : high[0];
+			}
+			low[0] = (low[1] < low[0]) ? low[1] : low[0];
+			high[0] = (high[1] > high[0]) ? high[1] : high[0];
+			std::pair<T, T> result = scalar(in + i, n - i);
+			for (std::size_t l = 0; l < lanes; ++l) {
+				result.first = (low[0][l] < result.first) ? low[0][l] : result.first;
+				result.second = (high[0][l] > result.second) ? high[0][l] : result.second;
+			}
+			return result;
+		}
+#endif
+	};
+
+	// transform and count_if call a user function, which can't safely be handed vectors: when it isn't inlined
+	// it is compiled for the default instruction set, which passes wide vectors differently.
+	// So they call it one value at a time in fixed blocks of a vector's worth, which the compiler vectorises
+	// once the function is inlined into the wrapper for each instruction set.
+
+	struct transform_kernel {
+		template <typename T, typename Fn>
+		static int scalar(T* out, const T* in, const std::size_t n, Fn& fn) {
+			for (std::size_t i = 0; i < n; ++i)
+				out[i] = T(fn(in[i]));
+			return 0;
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T, typename Fn>
+		PZ_SIMD_INLINE static int run(T* out, const T* in, const std::size_t n, Fn& fn) {
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			std::size_t i = 0;
+			for (; i + lanes <= n; i += lanes) {
+				T block[lanes];
+				for (std::size_t l = 0; l < lanes; ++l)
+					block[l] = T(fn(in[i + l]));
+				std::memcpy(out + i, block, sizeof(block));
+			}
+			return scalar(out + i, in + i, n - i, fn);
+		}
+#endif
+	};
+
+	struct count_if_kernel {
+		template <typename T, typename Pred>
+		static std::size_t scalar(const T* in, const std::size_t n, Pred& pred) {
+			std::size_t count = 0;
+			for (std::size_t i = 0; i < n; ++i)
+				count += pred(in[i]) ? 1 : 0;
+			return count;
+		}
+#if PZ_HAS_SIMD
+		template <std::size_t Bytes, typename T, typename Pred>
+		PZ_SIMD_INLINE static std::size_t run(const T* in, const std::size_t n, Pred& pred) {
+			constexpr std::size_t lanes = Bytes / sizeof(T);
+			// Per-lane counters as wide as T, added up before they can overflow
+			using counter = std::make_unsigned_t<typename std::conditional_t<std::is_integral<T>::value,
+				std::common_type<T>, std::conditional<sizeof(T) == 4, std::int32_t, std::int64_t>>::type>;
+			constexpr std::size_t block = std::size_t(std::min<std::uintmax_t>(std::numeric_limits<counter>::max(), 1u << 20)) * lanes;
+			std::size_t count = 0, i = 0;
+			while (i + lanes <= n) {
+				counter counts[lanes] = {};
+				const std::size_t stop = std::min(n - n % lanes, i + block);
+				for (; i < stop; i += lanes)
+					for (std::size_t l = 0; l < lanes; ++l)
+						counts[l] += pred(in[i + l]) ? 1 : 0;
+				for (std::size_t l = 0; l < lanes; ++l)
+					count += counts[l];
+			}
+			return count + scalar(in + i, n - i, pred);
+		}
+#endif
+	};
+
+	//// Interface
+
+	// Sets the [n] values at [out] to [value]
+	// Takes O(n) time.
+	template <typename T>
+	void fill(T* out, const std::size_t n, const T value) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		dispatch<fill_kernel>(out, n, value);
+	}
+
+	// Copies [n] values from [in] to [out], which must not overlap
+	// Takes O(n) time.
+	template <typename T>
+	void copy(T* out, const T* in, const std::size_t n) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		dispatch<copy_kernel>(out, in, n);
+	}
+
+	// Returns the sum of [n] values, in T, with integers wrapping around on overflow
+	// Floating point values are added in a different order than a scalar loop, so rounding can differ.
+	// Takes O(n) time.
+	template <typename T>
+	T sum(const T* in, const std::size_t n) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		return dispatch<sum_kernel>(in, n);
+	}
+
+	// Returns the sum of the products of [n] pairs of values from [a] and [b], in T like sum
+	// Takes O(n) time.
+	template <typename T>
+	T dot(const T* a, const T* b, const std::size_t n) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		return dispatch<dot_kernel>(a, b, n);
+	}
+
+	// Returns the lowest and highest of [n] values, or the type's highest and lowest value if there are none
+	// Takes O(n) time. NaNs give unspecified results.
+	template <typename T>
+	std::pair<T, T> min_max(const T* in, const std::size_t n) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		return dispatch<min_max_kernel>(in, n);
+	}
+
+	// Writes fn(x) for each of the [n] values x at [in] to [out], which can be the same array
+	// Vectorised when [fn] can be inlined and is made of operations the processor has vector forms of, like [](float x) { return x * 3 + 1; }.
+	// Takes O(n) time.
+	template <typename T, typename Fn>
+	void transform(T* out, const T* in, const std::size_t n, Fn fn) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		dispatch<transform_kernel>(out, in, n, fn);
+	}
+
+	// Returns how many of the [n] values at [in] satisfy [pred]
+	// Vectorised on the same terms as transform, e.g. for [](int x) { return x > 5; }.
+	// Takes O(n) time.
+	template <typename T, typename Pred>
+	std::size_t count_if(const T* in, const std::size_t n, Pred pred) {
+		static_assert(supported<T>::value, "SIMD kernels only take integer and floating point types");
+		return dispatch<count_if_kernel>(in, n, pred);
+	}
+}
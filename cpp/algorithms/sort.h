@@ -1,4 +1,19 @@
+#pragma once
 #include <vector>
+#include <cstddef>
+#include <utility>
+#include <array>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <stdexcept>
+#include <cmath>
 // Auxiliary functions
 template <typename T>
 void Swap (T &a, T &b){
@@ -7,37 +22,892 @@ void Swap (T &a, T &b){
   b = temp;
 }
 
-int ilog(unsigned int x) {
+inline int ilog(unsigned int x) {
 	return (x > 1) ? 1 + ilog(x / 10) : 0;
 }
 
+// Number of bits in each radix digit, one byte gives 256 buckets per pass
+constexpr unsigned int radix_bits = 8;
+constexpr std::size_t radix_buckets = std::size_t(1) << radix_bits;
+constexpr unsigned int radix_mask = radix_buckets - 1;
+
+// Maps a key onto an unsigned integer that sorts in the same order as the key
+template <typename K, typename = void>
+struct radix_traits;
+
+// Unsigned integers are already in order
+template <typename K>
+struct radix_traits<K, std::enable_if_t<std::is_unsigned<K>::value && std::is_integral<K>::value && !std::is_same<K, bool>::value>> {
+	using bits_type = K;
+	static bits_type to_bits(const K key) noexcept { return key; }
+};
+
+// Signed integers flip the sign bit so negatives come before positives
+template <typename K>
+struct radix_traits<K, std::enable_if_t<std::is_signed<K>::value && std::is_integral<K>::value>> {
+	using bits_type = std::make_unsigned_t<K>;
+	static bits_type to_bits(const K key) noexcept {
+		return static_cast<bits_type>(key) ^ (bits_type(1) << (sizeof(K) * 8 - 1));
+	}
+};
+
+// IEEE floats flip every bit of negatives, as a larger magnitude is a smaller value, and only the sign bit of positives
+// NaNs end up at whichever end their sign bit puts them.
+template <typename K>
+struct radix_traits<K, std::enable_if_t<std::is_floating_point<K>::value && std::numeric_limits<K>::is_iec559 && (sizeof(K) == 4 || sizeof(K) == 8)>> {
+	using bits_type = std::conditional_t<sizeof(K) == 4, std::uint32_t, std::uint64_t>;
+	static bits_type to_bits(const K key) noexcept {
+		bits_type bits;
+		std::memcpy(&bits, &key, sizeof(bits));
+		const bits_type sign = bits_type(1) << (sizeof(K) * 8 - 1);
+		return (bits & sign) ? ~bits : (bits | sign);
+	}
+};
+
+// Key extractor that sorts items by their own value
+struct radix_identity {
+	template <typename T>
+	const T& operator()(const T& item) const noexcept { return item; }
+};
+
+// Key type that [KeyFn] extracts from a [T]
+template <typename T, typename KeyFn>
+using radix_key_t = std::decay_t<std::invoke_result_t<KeyFn&, const T&>>;
+
+// Whether [KeyFn] extracts a key radix sort can order from a [T]
+template <typename T, typename KeyFn, typename = void>
+struct is_radix_key_fn : std::false_type {};
+template <typename T, typename KeyFn>
+struct is_radix_key_fn<T, KeyFn, std::void_t<typename radix_traits<radix_key_t<T, KeyFn>>::bits_type>> : std::true_type {};
+
+// Byte digit of the item's key at [shift]
+// Takes O(1) time.
+template <typename T, typename KeyFn>
+inline std::size_t radix_digit(const T& item, KeyFn& key, const unsigned int shift) {
+	return (radix_traits<radix_key_t<T, KeyFn>>::to_bits(key(item)) >> shift) & radix_mask;
+}
+
 // Sorts
 
-// Counting sort with buckets
-void counting_sort(std::vector<unsigned int> &arr, int rad) { // Counting sort
-	std::vector<int> tempArr[10]; // Creates an array of vectors, one for each digit from 0-9
-	for (auto i : arr)
-		tempArr[(i / rad) % 10].push_back(i);
+// Moves each item to the next free slot of its digit's bucket, advancing the offsets as it goes
+// Takes O(n) time.
+template <typename T, typename KeyFn>
+inline void radix_scatter(T* in, T* out, std::size_t n, unsigned int shift, std::size_t* offsets, KeyFn& key) {
+	for (T* item = in, *end = in + n; item != end; ++item)
+		out[offsets[radix_digit(*item, key, shift)]++] = std::move(*item);
+}
+
+// Counting sort on a single byte digit
+// Scatters [in] into [out] using the bucket counts already gathered for the digit at [shift]
+// Takes O(n) time.
+template <typename T, typename KeyFn>
+inline void counting_sort(T* in, T* out, std::size_t n, unsigned int shift, const std::size_t* counts, KeyFn& key) {
 	/*
-	// Rad
-	Rad is the column being evaluated
-	e.g. if number 30 is entered, rad is 10, if 3 is picked, rad is 1.
-	// Position : (i / rad % 10)
-	Position is based on the value of the digit, if number is 162 and rad is 10, position will be 6
+	// Offsets
+	Prefix sum of the counts, offsets[d] is where the next key with digit d is written
+	e.g. counts of {2, 0, 3} give offsets of {0, 2, 2}
+	// Digit : (key >> shift) & radix_mask
+	If key is 0x1234 and shift is 8, digit will be 0x12
 	*/
-	arr.clear(); // Clear original array
-	for (auto i : tempArr)
-		for (auto j : i)
-			arr.push_back(j); // Adds numbers back into original array
+	std::size_t offsets[radix_buckets];
+	std::size_t sum = 0;
+	for (std::size_t d = 0; d < radix_buckets; ++d) {
+		offsets[d] = sum;
+		sum += counts[d];
+	}
+	radix_scatter(in, out, n, shift, offsets, key);
+}
+// Radix sort of items by the key [key] extracts from them, using byte-wise counting sort passes
+// Keys can be any integer or IEEE float type, and the items move along with their keys.
+// The sort is stable. T must be default constructible for the scratch buffer.
+// Takes O(n) time, at most sizeof(key) passes.
+template <typename T, typename KeyFn, std::enable_if_t<is_radix_key_fn<T, KeyFn>::value, int> = 0>
+void radix_sort(std::vector<T> &arr, KeyFn key) { // Least Significant Digit Radix Sort
+	constexpr unsigned int digits = sizeof(typename radix_traits<radix_key_t<T, KeyFn>>::bits_type);
+	const std::size_t n = arr.size();
+	if (n < 2)
+		return;
+
+	// A single pass over the keys builds the histogram of every digit at once
+	std::size_t counts[digits][radix_buckets] = {};
+	for (const auto& item : arr) {
+		const auto bits = radix_traits<radix_key_t<T, KeyFn>>::to_bits(key(item));
+		for (unsigned int d = 0; d < digits; ++d)
+			++counts[d][(bits >> (d * radix_bits)) & radix_mask];
+	}
+
+	// Ping-pong between the input and one scratch buffer rather than allocating per pass
+	std::vector<T> scratch(n);
+	T* from = arr.data();
+	T* to = scratch.data();
+	for (unsigned int d = 0; d < digits; ++d) {
+		const unsigned int shift = d * radix_bits;
+
+		// Every key has the same digit, so this pass would not move anything
+		if (counts[d][radix_digit(*from, key, shift)] == n)
+			continue;
+
+		counting_sort(from, to, n, shift, counts[d], key);
+		std::swap(from, to);
+	}
+	// Odd number of passes leaves the sorted items in the scratch buffer
+	if (from != arr.data())
+		arr.swap(scratch);
+}
+// Radix sort of integer or IEEE float keys
+// Takes O(n) time.
+template <typename T>
+void radix_sort(std::vector<T> &arr) {
+	radix_sort(arr, radix_identity{});
+}
+
+// Returns the indices of [arr] in the order its items' keys sort into, leaving [arr] untouched
+// Takes O(n) time.
+template <typename T, typename KeyFn = radix_identity>
+std::vector<std::size_t> radix_sort_permutation(const std::vector<T> &arr, KeyFn key = {}) {
+	std::vector<std::size_t> order(arr.size());
+	for (std::size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	radix_sort(order, [&arr, &key](const std::size_t i) { return key(arr[i]); });
+	return order;
+}
+
+// Below this many keys per thread starting the threads costs more than the work they share
+constexpr std::size_t parallel_radix_threshold = std::size_t(1) << 16;
+
+// Radix sort split across [threads] threads, each owning one contiguous chunk of the items
+// Every pass builds per-thread histograms, merges them into global scatter offsets and scatters in parallel.
+// Falls back to radix_sort below parallel_radix_threshold items per thread.
+// Takes O(n / threads) time per pass.
+template <typename T, typename KeyFn, std::enable_if_t<is_radix_key_fn<T, KeyFn>::value, int> = 0>
+void parallel_radix_sort(std::vector<T> &arr, KeyFn key, unsigned int threads = std::thread::hardware_concurrency()) {
+	constexpr unsigned int digits = sizeof(typename radix_traits<radix_key_t<T, KeyFn>>::bits_type);
+	const std::size_t n = arr.size();
+
+	// Give every thread at least a threshold's worth of items
+	threads = static_cast<unsigned int>(std::min<std::size_t>(threads, n / parallel_radix_threshold));
+	if (threads < 2) {
+		radix_sort(arr, key);
+		return;
+	}
+	const std::size_t chunk = (n + threads - 1) / threads;
+
+	// Runs job(t) on every thread and waits for all of them to finish
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	auto run = [&workers, threads](auto job) {
+		for (unsigned int t = 0; t < threads; ++t)
+			workers.emplace_back(job, t);
+		for (auto& worker : workers)
+			worker.join();
+		workers.clear();
+	};
+
+	std::vector<std::array<std::size_t, radix_buckets>> counts(threads);
+	std::vector<T> scratch(n);
+	T* from = arr.data();
+	T* to = scratch.data();
+	for (unsigned int d = 0; d < digits; ++d) {
+		const unsigned int shift = d * radix_bits;
+
+		// Histogram of this digit over each thread's chunk
+		run([&counts, &key, from, n, chunk, shift](unsigned int t) {
+			auto& local = counts[t];
+			local.fill(0);
+			const std::size_t begin = std::min(t * chunk, n), end = std::min(begin + chunk, n);
+			for (std::size_t i = begin; i < end; ++i)
+				++local[radix_digit(from[i], key, shift)];
+		});
+
+		/*
+		// Offsets
+		Buckets are laid out in digit order, and within a bucket the chunks are laid out in thread order,
+		so counts[t][b] becomes where thread t writes its first key with digit b and the sort stays stable
+		*/
+		bool uniform = false;
+		std::size_t sum = 0;
+		for (std::size_t b = 0; b < radix_buckets; ++b) {
+			const std::size_t bucket_start = sum;
+			for (auto& local : counts) {
+				const std::size_t count = local[b];
+				local[b] = sum;
+				sum += count;
+			}
+			// Every key has the same digit, so this pass would not move anything
+			if (sum - bucket_start == n)
+				uniform = true;
+		}
+		if (uniform)
+			continue;
+
+		run([&counts, &key, from, to, n, chunk, shift](unsigned int t) {
+			const std::size_t begin = std::min(t * chunk, n), end = std::min(begin + chunk, n);
+			radix_scatter(from + begin, to, end - begin, shift, counts[t].data(), key);
+		});
+		std::swap(from, to);
+	}
+	// Odd number of passes leaves the sorted items in the scratch buffer
+	if (from != arr.data())
+		arr.swap(scratch);
+}
+// Parallel radix sort of integer or IEEE float keys
+// Takes O(n / threads) time per pass.
+template <typename T>
+void parallel_radix_sort(std::vector<T> &arr, unsigned int threads = std::thread::hardware_concurrency()) {
+	parallel_radix_sort(arr, radix_identity{}, threads);
+}
+
+// Partitions smaller than this are finished with insertion sort
+constexpr std::ptrdiff_t intro_insertion_threshold = 24;
+// Partitions larger than this pick their pivot from a median of medians of three
+constexpr std::ptrdiff_t intro_ninther_threshold = 128;
+// Partitions of arithmetic keys this small or smaller are finished with a sorting network
+constexpr std::ptrdiff_t intro_network_size = 16;
+// Number of elements classified at a time by the branchless partition
+constexpr std::size_t intro_block_size = 64;
+
+// Whether small partitions can go through the branchless sorting network
+// Only ascending order of non-bool arithmetic types, which have a largest value to pad with.
+template <typename T, typename Compare>
+struct intro_uses_network : std::integral_constant<bool,
+	std::is_arithmetic<T>::value && !std::is_same<T, bool>::value &&
+	(std::is_same<Compare, std::less<>>::value || std::is_same<Compare, std::less<T>>::value)> {};
+
+// Sorts the items so that *a <= *b <= *c
+template <typename Iter, typename Compare>
+inline void intro_sort3(Iter a, Iter b, Iter c, Compare& comp) {
+	if (comp(*b, *a)) std::iter_swap(a, b);
+	if (comp(*c, *b)) std::iter_swap(b, c);
+	if (comp(*b, *a)) std::iter_swap(a, b);
+}
+
+// Insertion sort
+// Takes O(n^2) time, O(n) when already sorted.
+template <typename Iter, typename Compare>
+void insertion_sort(Iter first, Iter last, Compare comp = Compare{}) {
+	if (first == last)
+		return;
+	for (Iter cur = first + 1; cur != last; ++cur) {
+		if (comp(*cur, *(cur - 1))) {
+			auto temp = std::move(*cur);
+			Iter sift = cur;
+			// Shift larger items up until the gap reaches where temp belongs
+			do {
+				*sift = std::move(*(sift - 1));
+				--sift;
+			} while (sift != first && comp(temp, *(sift - 1)));
+			*sift = std::move(temp);
+		}
+	}
+}
+
+// Insertion sort that gives up after moving a handful of items
+// Returns whether the range ended up sorted.
+// Takes O(n) time.
+template <typename Iter, typename Compare>
+bool intro_partial_insertion_sort(Iter first, Iter last, Compare& comp) {
+	if (first == last)
+		return true;
+	std::ptrdiff_t moved = 0;
+	for (Iter cur = first + 1; cur != last; ++cur) {
+		if (comp(*cur, *(cur - 1))) {
+			auto temp = std::move(*cur);
+			Iter sift = cur;
+			do {
+				*sift = std::move(*(sift - 1));
+				--sift;
+			} while (sift != first && comp(temp, *(sift - 1)));
+			*sift = std::move(temp);
+			moved += cur - sift;
+		}
+		if (moved > 8)
+			return false;
+	}
+	return true;
+}
+
+// Heap sort, used once quicksort keeps picking bad pivots
+// Takes O(n log n) time.
+template <typename Iter, typename Compare>
+void heap_sort(Iter first, Iter last, Compare comp = Compare{}) {
+	const std::ptrdiff_t size = last - first;
+	// Moves the item at [root] down until both children are no greater than it
+	auto sift_down = [first, &comp](std::ptrdiff_t root, const std::ptrdiff_t end) {
+		auto temp = std::move(first[root]);
+		for (std::ptrdiff_t child; (child = 2 * root + 1) < end; root = child) {
+			if (child + 1 < end && comp(first[child], first[child + 1]))
+				++child;
+			if (!comp(temp, first[child]))
+				break;
+			first[root] = std::move(first[child]);
+		}
+		first[root] = std::move(temp);
+	};
+	for (std::ptrdiff_t i = size / 2; i-- > 0;)
+		sift_down(i, size);
+	for (std::ptrdiff_t end = size - 1; end > 0; --end) {
+		std::iter_swap(first, first + end);
+		sift_down(0, end);
+	}
 }
-// Radix sort using counting sort with buckets
-void radix_sort(std::vector<unsigned int> &arr) { // Least Siginificant Digit Radix Sort
-	unsigned int max = 0;
-	for (auto i : arr) {
-		max = (i > max) ? i : max;
+
+// Sorts up to intro_network_size arithmetic items with a fixed bitonic network
+// Every compare-exchange is a branchless min/max and the loops have constant bounds,
+// so the compiler can unroll them and keep the items in vector registers.
+// Takes O(1) time.
+template <typename Iter>
+void intro_network_sort(Iter first, Iter last) {
+	using T = typename std::iterator_traits<Iter>::value_type;
+	constexpr std::size_t size = intro_network_size;
+	const std::size_t count = last - first;
+
+	// Pad the unused slots with the largest value so they sort to the end
+	T items[size];
+	for (std::size_t i = 0; i < size; ++i)
+		items[i] = (i < count) ? first[i] : (std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max());
+
+	for (std::size_t k = 2; k <= size; k <<= 1) {
+		for (std::size_t j = k >> 1; j > 0; j >>= 1) {
+			for (std::size_t i = 0; i < size; ++i) {
+				const std::size_t l = i ^ j;
+				if (l > i) {
+					// Half of each bitonic block sorts up, the other half down
+					const std::size_t lo = (i & k) ? l : i, hi = (i & k) ? i : l;
+					// Each slot takes a different one of the pair, so equivalent values such as 0.0 and -0.0 are both kept
+					const T a = items[lo], b = items[hi];
+					const bool swapped = b < a;
+					items[lo] = swapped ? b : a;
+					items[hi] = swapped ? a : b;
+				}
+			}
+		}
 	}
-	int radix = 10;
-	for (int i = 1; max / i > 0; i*= radix) {
-		counting_sort(arr, i);
+	std::copy(items, items + count, first);
+}
+
+// Partitions around the pivot at [first] without branching on the comparison results
+// Offsets of misplaced items are gathered a block at a time and then swapped in bulk.
+// Returns the final pivot position and whether the range was already partitioned.
+// Takes O(n) time.
+template <typename Iter, typename Compare>
+std::pair<Iter, bool> intro_partition_branchless(Iter first, Iter last, Compare& comp) {
+	auto pivot = std::move(*first);
+	Iter begin = first, left = first, right = last;
+
+	// The median of three guarantees an item no less than the pivot at the end
+	while (comp(*++left, pivot));
+	if (left - 1 == begin)
+		while (left < right && !comp(*--right, pivot));
+	else
+		while (!comp(*--right, pivot));
+
+	const bool already_partitioned = left >= right;
+	if (!already_partitioned) {
+		std::iter_swap(left, right);
+		++left;
+
+		unsigned char offsets_l[intro_block_size], offsets_r[intro_block_size];
+		Iter base_l = left, base_r = right;
+		std::size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+		while (left < right) {
+			// Split the unclassified items between whichever sides ran out of offsets
+			const std::size_t unknown = right - left;
+			const std::size_t split_l = (num_l == 0) ? ((num_r == 0) ? unknown / 2 : unknown) : 0;
+			const std::size_t split_r = (num_r == 0) ? (unknown - split_l) : 0;
+
+			// Record every item on the left that belongs on the right, and vice versa
+			for (std::size_t i = 0, n = std::min(split_l, intro_block_size); i < n; ++i) {
+				offsets_l[num_l] = static_cast<unsigned char>(i);
+				num_l += !comp(*left, pivot);
+				++left;
+			}
+			for (std::size_t i = 0, n = std::min(split_r, intro_block_size); i < n;) {
+				offsets_r[num_r] = static_cast<unsigned char>(++i);
+				num_r += comp(*--right, pivot);
+			}
+
+			const std::size_t num = std::min(num_l, num_r);
+			for (std::size_t i = 0; i < num; ++i)
+				std::iter_swap(base_l + offsets_l[start_l + i], base_r - offsets_r[start_r + i]);
+			num_l -= num;
+			num_r -= num;
+			start_l += num;
+			start_r += num;
+			if (num_l == 0) {
+				start_l = 0;
+				base_l = left;
+			}
+			if (num_r == 0) {
+				start_r = 0;
+				base_r = right;
+			}
+		}
+
+		// Leftover misplaced items on one side get swapped against the middle
+		if (num_l) {
+			while (num_l--)
+				std::iter_swap(base_l + offsets_l[start_l + num_l], --right);
+			left = right;
+		}
+		if (num_r) {
+			while (num_r--)
+				std::iter_swap(base_r - offsets_r[start_r + num_r], left++);
+		}
 	}
+
+	Iter pivot_pos = left - 1;
+	*begin = std::move(*pivot_pos);
+	*pivot_pos = std::move(pivot);
+	return { pivot_pos, already_partitioned };
 }
+
+// Partitions around the pivot at [first], leaving items equal to the pivot on its right
+// Returns the final pivot position and whether the range was already partitioned.
+// Takes O(n) time.
+template <typename Iter, typename Compare>
+std::pair<Iter, bool> intro_partition_right(Iter first, Iter last, Compare& comp) {
+	auto pivot = std::move(*first);
+	Iter begin = first, left = first, right = last;
+
+	while (comp(*++left, pivot));
+	if (left - 1 == begin)
+		while (left < right && !comp(*--right, pivot));
+	else
+		while (!comp(*--right, pivot));
+
+	const bool already_partitioned = left >= right;
+	while (left < right) {
+		std::iter_swap(left, right);
+		while (comp(*++left, pivot));
+		while (!comp(*--right, pivot));
+	}
+
+	Iter pivot_pos = left - 1;
+	*begin = std::move(*pivot_pos);
+	*pivot_pos = std::move(pivot);
+	return { pivot_pos, already_partitioned };
+}
+
+// Partitions around the pivot at [first], leaving items equal to the pivot on its left
+// Used when the pivot equals the item before the range, so the whole run of equal items is finished at once.
+// Takes O(n) time.
+template <typename Iter, typename Compare>
+Iter intro_partition_left(Iter first, Iter last, Compare& comp) {
+	auto pivot = std::move(*first);
+	Iter left = first, right = last;
+
+	while (comp(pivot, *--right));
+	if (right + 1 == last)
+		while (left < right && !comp(pivot, *++left));
+	else
+		while (!comp(pivot, *++left));
+
+	while (left < right) {
+		std::iter_swap(left, right);
+		while (comp(pivot, *--right));
+		while (!comp(pivot, *++left));
+	}
+
+	*first = std::move(*right);
+	*right = std::move(pivot);
+	return right;
+}
+
+// Quicksort loop of intro_sort, recursing into the left partition and looping on the right
+// [bad_allowed] is how many unbalanced partitions are tolerated before switching to heap sort.
+template <typename Iter, typename Compare>
+void intro_sort_loop(Iter first, Iter last, Compare& comp, int bad_allowed, bool leftmost) {
+	using T = typename std::iterator_traits<Iter>::value_type;
+	while (true) {
+		const std::ptrdiff_t size = last - first;
+		if (intro_uses_network<T, Compare>::value && size <= intro_network_size) {
+			intro_network_sort(first, last);
+			return;
+		}
+		if (size < intro_insertion_threshold) {
+			insertion_sort(first, last, comp);
+			return;
+		}
+
+		// Move the pivot to the front, with a median of three or a median of medians of three
+		const std::ptrdiff_t half = size / 2;
+		if (size > intro_ninther_threshold) {
+			intro_sort3(first, first + half, last - 1, comp);
+			intro_sort3(first + 1, first + (half - 1), last - 2, comp);
+			intro_sort3(first + 2, first + (half + 1), last - 3, comp);
+			intro_sort3(first + (half - 1), first + half, first + (half + 1), comp);
+			std::iter_swap(first, first + half);
+		}
+		else
+			intro_sort3(first + half, first, last - 1, comp);
+
+		// The item before this partition is no greater than anything in it,
+		// so if it equals the pivot every item equal to the pivot can be finished now
+		if (!leftmost && !comp(*(first - 1), *first)) {
+			first = intro_partition_left(first, last, comp) + 1;
+			continue;
+		}
+
+		const auto result = std::is_arithmetic<T>::value
+			? intro_partition_branchless(first, last, comp)
+			: intro_partition_right(first, last, comp);
+		const Iter pivot_pos = result.first;
+		const std::ptrdiff_t size_l = pivot_pos - first, size_r = last - (pivot_pos + 1);
+
+		if (size_l < size / 8 || size_r < size / 8) {
+			// Too many bad pivots means the input is adversarial, so fall back to heap sort
+			if (--bad_allowed == 0) {
+				heap_sort(first, last, comp);
+				return;
+			}
+			// Swap a few items around to break up whatever pattern caused the bad pivot
+			if (size_l >= intro_insertion_threshold) {
+				std::iter_swap(first, first + size_l / 4);
+				std::iter_swap(pivot_pos - 1, pivot_pos - size_l / 4);
+				if (size_l > intro_ninther_threshold) {
+					std::iter_swap(first + 1, first + (size_l / 4 + 1));
+					std::iter_swap(first + 2, first + (size_l / 4 + 2));
+					std::iter_swap(pivot_pos - 2, pivot_pos - (size_l / 4 + 1));
+					std::iter_swap(pivot_pos - 3, pivot_pos - (size_l / 4 + 2));
+				}
+			}
+			if (size_r >= intro_insertion_threshold) {
+				std::iter_swap(pivot_pos + 1, pivot_pos + (1 + size_r / 4));
+				std::iter_swap(last - 1, last - size_r / 4);
+				if (size_r > intro_ninther_threshold) {
+					std::iter_swap(pivot_pos + 2, pivot_pos + (2 + size_r / 4));
+					std::iter_swap(pivot_pos + 3, pivot_pos + (3 + size_r / 4));
+					std::iter_swap(last - 2, last - (1 + size_r / 4));
+					std::iter_swap(last - 3, last - (2 + size_r / 4));
+				}
+			}
+		}
+		// A balanced partition that moved nothing is likely an already sorted run, so try to finish it cheaply
+		else if (result.second && intro_partial_insertion_sort(first, pivot_pos, comp)
+			&& intro_partial_insertion_sort(pivot_pos + 1, last, comp))
+			return;
+
+		intro_sort_loop(first, pivot_pos, comp, bad_allowed, leftmost);
+		first = pivot_pos + 1;
+		leftmost = false;
+	}
+}
+
+// Pattern-defeating introsort
+// Quicksort with branchless block partitioning for arithmetic types, heap sort once it keeps picking bad pivots,
+// and a sorting network or insertion sort on small partitions. Not stable.
+// Works on any random access range, e.g. std::vector, pz::dynamic_array or pz::heap_array through begin() and end().
+// Takes O(n log n) time, O(n) on sorted or reverse sorted input.
+template <typename Iter, typename Compare = std::less<>>
+void intro_sort(Iter first, Iter last, Compare comp = Compare{}) {
+	const std::ptrdiff_t size = last - first;
+	if (size < 2)
+		return;
+	int log2 = 0;
+	for (std::ptrdiff_t n = size; n > 1; n >>= 1)
+		++log2;
+	intro_sort_loop(first, last, comp, log2, true);
+}
+
+// Buckets of string_sort below this size use multikey quicksort instead of an American flag pass
+constexpr std::ptrdiff_t string_flag_threshold = 1024;
+// Buckets of multikey quicksort below this size are finished with insertion sort
+constexpr std::ptrdiff_t string_insertion_threshold = 16;
+
+// Character of the string at [depth] as a bucket, 0 for strings that have already ended
+// Characters compare as unsigned char, the same as std::string does.
+// Takes O(1) time.
+template <typename S>
+inline unsigned int string_digit(const S& str, const std::size_t depth) {
+	return (depth < str.size()) ? static_cast<unsigned char>(str.data()[depth]) + 1u : 0u;
+}
+
+// Insertion sort of strings that are known to share their first [depth] characters
+// Takes O(n^2) comparisons of the remaining suffixes.
+template <typename Iter>
+void string_insertion_sort(Iter first, Iter last, const std::size_t depth) {
+	// Strings that share a prefix only need their suffixes compared
+	auto suffix = [depth](const auto& str) {
+		return std::string_view(str.data(), str.size()).substr(std::min(depth, static_cast<std::size_t>(str.size())));
+	};
+	insertion_sort(first, last, [&suffix](const auto& a, const auto& b) { return suffix(a) < suffix(b); });
+}
+
+// Multikey quicksort, a three way quicksort on the character at [depth]
+// Strings equal to the pivot character move onto the next character rather than being compared again.
+// Takes O(n log n + d) time, where d is the total length of the distinguishing prefixes.
+template <typename Iter>
+void multikey_quicksort(Iter first, Iter last, std::size_t depth) {
+	while (last - first >= string_insertion_threshold) {
+		// Median of three characters as the pivot
+		const std::ptrdiff_t size = last - first;
+		unsigned int a = string_digit(*first, depth), b = string_digit(first[size / 2], depth), c = string_digit(*(last - 1), depth);
+		if (b < a) std::swap(a, b);
+		if (c < b) std::swap(b, c);
+		if (b < a) std::swap(a, b);
+		const unsigned int pivot = b;
+
+		// Partition into [first, lt) < pivot, [lt, gt) == pivot, [gt, last) > pivot
+		Iter lt = first, it = first, gt = last;
+		while (it < gt) {
+			const unsigned int digit = string_digit(*it, depth);
+			if (digit < pivot)
+				std::iter_swap(lt++, it++);
+			else if (digit > pivot)
+				std::iter_swap(it, --gt);
+			else
+				++it;
+		}
+
+		// Strings that ended at this depth are all equal and need no more sorting
+		struct part {
+			Iter first, last;
+			std::size_t depth;
+		};
+		const part parts[3] = { { first, lt, depth }, { lt, pivot ? gt : lt, depth + 1 }, { gt, last, depth } };
+
+		// Only the smaller parts are sorted recursively and the loop carries on with the largest, so strings that all
+		// share a long prefix step along it here rather than recursing once per character, and at most log n frames are used
+		std::size_t largest = 0;
+		for (std::size_t i = 1; i < 3; ++i)
+			if (parts[i].last - parts[i].first > parts[largest].last - parts[largest].first)
+				largest = i;
+		for (std::size_t i = 0; i < 3; ++i)
+			if (i != largest)
+				multikey_quicksort(parts[i].first, parts[i].last, parts[i].depth);
+		first = parts[largest].first;
+		last = parts[largest].last;
+		depth = parts[largest].depth;
+	}
+	string_insertion_sort(first, last, depth);
+}
+
+// American flag sort, an in-place MSD radix sort on the character at [depth]
+// One pass counts the buckets, a second permutes every string straight into its bucket by following cycles,
+// then every bucket is sorted on the next character.
+// Only the smaller buckets are sorted recursively. The largest one, including a range whose strings all share
+// the character, is sorted by the loop, so long common prefixes such as paths or URLs don't deepen the recursion
+// and there are at most log n frames of bucket arrays on the stack.
+// Takes O(n + d) time, where d is the total length of the distinguishing prefixes.
+template <typename Iter>
+void american_flag_sort(Iter first, Iter last, std::size_t depth) {
+	constexpr std::size_t buckets = 257;
+	// Each string's character is read once and cached, as the strings themselves are scattered in memory
+	std::vector<unsigned short> digits;
+	for (;; ++depth) {
+		const std::ptrdiff_t size = last - first;
+		if (size < string_flag_threshold) {
+			multikey_quicksort(first, last, depth);
+			return;
+		}
+
+		digits.resize(size);
+		std::size_t counts[buckets] = {};
+		for (std::ptrdiff_t i = 0; i < size; ++i)
+			++counts[digits[i] = static_cast<unsigned short>(string_digit(first[i], depth))];
+
+		// Every string shares this character, so move straight onto the next one
+		if (counts[digits[0]] == static_cast<std::size_t>(size)) {
+			if (!digits[0])
+				return;
+			continue;
+		}
+
+		// heads[b] is the next unplaced slot of bucket b, tails[b] is where bucket b ends
+		std::size_t heads[buckets], tails[buckets];
+		std::size_t sum = 0;
+		for (std::size_t b = 0; b < buckets; ++b) {
+			heads[b] = sum;
+			sum += counts[b];
+			tails[b] = sum;
+		}
+
+		for (std::size_t b = 0; b < buckets; ++b) {
+			while (heads[b] < tails[b]) {
+				// Swap the string at the head into its own bucket until one that belongs here comes back
+				unsigned short digit = digits[heads[b]];
+				while (digit != b) {
+					const std::size_t dest = heads[digit]++;
+					std::iter_swap(first + heads[b], first + dest);
+					std::swap(digit, digits[dest]);
+				}
+				++heads[b];
+			}
+		}
+
+		// Bucket 0 holds strings that have ended, which are all equal
+		std::size_t largest = 1;
+		for (std::size_t b = 2; b < buckets; ++b)
+			if (counts[b] > counts[largest])
+				largest = b;
+		for (std::size_t b = 1, start = counts[0]; b < buckets; start += counts[b++])
+			if (b != largest && counts[b] > 1)
+				american_flag_sort(first + start, first + (start + counts[b]), depth + 1);
+		if (counts[largest] < 2)
+			return;
+		first += std::ptrdiff_t(tails[largest] - counts[largest]);
+		last = first + std::ptrdiff_t(counts[largest]);
+	}
+}
+
+// Sorts strings into lexicographic order with an MSD radix sort
+// Works with any random access range of std::string, std::string_view or other types with data() and size().
+// Takes time proportional to the distinguishing prefixes rather than n log n full comparisons.
+template <typename Iter>
+void string_sort(Iter first, Iter last) {
+	american_flag_sort(first, last, 0);
+}
+// Sorts a container of strings into lexicographic order
+template <typename Container>
+void string_sort(Container& strings) {
+	string_sort(std::begin(strings), std::end(strings));
+}
+
+// Selection
+
+// Returns the item that would be at index [k] if [arr] were sorted by key, without sorting it
+// MSD radix select: the histogram of the top digit finds the bucket holding rank k,
+// only that bucket's items are kept, and the next digit narrows them down again.
+// Takes O(n) time, the first pass reads every item and each later pass about 1/256 of the previous.
+template <typename T, typename KeyFn = radix_identity, std::enable_if_t<is_radix_key_fn<T, KeyFn>::value, int> = 0>
+T radix_select(const std::vector<T> &arr, std::size_t k, KeyFn key = {}) {
+	if (k >= arr.size())
+		throw std::out_of_range("Index out of range");
+	constexpr unsigned int digits = sizeof(typename radix_traits<radix_key_t<T, KeyFn>>::bits_type);
+
+	const T* items = arr.data();
+	std::size_t n = arr.size();
+	std::vector<T> candidates;
+	for (unsigned int d = digits; d-- > 0;) {
+		const unsigned int shift = d * radix_bits;
+		std::size_t counts[radix_buckets] = {};
+		for (std::size_t i = 0; i < n; ++i)
+			++counts[radix_digit(items[i], key, shift)];
+
+		// Find the bucket holding rank k, and k's rank within that bucket
+		std::size_t bucket = 0;
+		while (k >= counts[bucket])
+			k -= counts[bucket++];
+
+		// Every candidate is in this bucket, so there is nothing to filter out
+		if (counts[bucket] == n)
+			continue;
+
+		std::vector<T> next;
+		next.reserve(counts[bucket]);
+		for (std::size_t i = 0; i < n; ++i)
+			if (radix_digit(items[i], key, shift) == bucket)
+				next.push_back(items[i]);
+		candidates.swap(next);
+		items = candidates.data();
+		n = candidates.size();
+	}
+	// Every remaining candidate has the same key
+	return items[k];
+}
+
+// Rearranges the range so the item at [nth] is the one that would be there if it were sorted,
+// with no item before it greater and no item after it less
+// Quickselect sharing intro_sort's pivot choice and partitioning, falling back to heap sort after too many bad pivots.
+// Takes O(n) time.
+template <typename Iter, typename Compare = std::less<>>
+void select_nth(Iter first, Iter nth, Iter last, Compare comp = Compare{}) {
+	if (nth == last)
+		return;
+	int bad_allowed = 0;
+	for (std::ptrdiff_t n = last - first; n > 1; n >>= 1)
+		++bad_allowed;
+
+	while (last - first >= intro_insertion_threshold) {
+		const std::ptrdiff_t size = last - first;
+		const std::ptrdiff_t half = size / 2;
+		intro_sort3(first + half, first, last - 1, comp);
+
+		const Iter pivot_pos = intro_partition_right(first, last, comp).first;
+		if (pivot_pos == nth)
+			return;
+		const std::ptrdiff_t size_l = pivot_pos - first, size_r = last - (pivot_pos + 1);
+
+		// Narrow down to the side holding nth
+		if (nth < pivot_pos)
+			last = pivot_pos;
+		else
+			first = pivot_pos + 1;
+
+		if ((size_l < size / 8 || size_r < size / 8) && --bad_allowed == 0) {
+			heap_sort(first, last, comp);
+			return;
+		}
+	}
+	insertion_sort(first, last, comp);
+}
+
+// Moves the [k] smallest items to the front of the range in sorted order, leaving the rest in no particular order
+// Use std::greater<>() as the comparison for the k largest.
+// Takes O(n + k log k) time.
+template <typename Iter, typename Compare = std::less<>>
+void partial_sort_top_k(Iter first, Iter last, std::size_t k, Compare comp = Compare{}) {
+	const auto size = static_cast<std::size_t>(last - first);
+	if (k >= size) {
+		intro_sort(first, last, comp);
+		return;
+	}
+	if (!k)
+		return;
+	select_nth(first, first + (k - 1), last, comp);
+	intro_sort(first, first + (k - 1), comp);
+}
+
+// Returns the nearest-rank item at percentile [p] out of 100, the smallest item with at least p% of the items
+// at or below it, e.g. 50 for the lower median. That is the item at index ceil(p / 100 * n) - 1 in sorted order.
+// Takes O(n) time.
+template <typename T, typename KeyFn = radix_identity, std::enable_if_t<is_radix_key_fn<T, KeyFn>::value, int> = 0>
+T percentile(const std::vector<T> &arr, double p, KeyFn key = {}) {
+	if (arr.empty())
+		throw std::out_of_range("Index out of range");
+	p = std::min(std::max(p, 0.0), 100.0);
+	// Multiplying before dividing keeps whole-number ranks exact, e.g. 90% of 10 items is 9 rather than 9.000000000000002
+	const auto rank = static_cast<std::size_t>(std::ceil(p * double(arr.size()) / 100.0));
+	return radix_select(arr, rank ? rank - 1 : 0, key);
+}
+
+// Keeps the k smallest items seen from a stream of unknown length
+// A max heap of the k kept items means each new item is checked against the largest in O(1)
+// and only replaces it when smaller. Use std::greater<>() as the comparison to keep the k largest instead.
+// Takes O(log k) time per item and O(k) space.
+template <typename T, typename Compare = std::less<>>
+struct streaming_top_k {
+	streaming_top_k(std::size_t k, Compare comparison = Compare{}) : limit(k), comp(comparison) {
+		heap.reserve(k);
+	}
+
+	// Offers an item to the top k
+	// Takes O(log k) time.
+	void push(const T& item) {
+		if (heap.size() < limit) {
+			heap.push_back(item);
+			std::push_heap(heap.begin(), heap.end(), comp);
+		}
+		else if (limit && comp(item, heap.front())) {
+			std::pop_heap(heap.begin(), heap.end(), comp);
+			heap.back() = item;
+			std::push_heap(heap.begin(), heap.end(), comp);
+		}
+	}
+
+	// Number of items kept, at most k
+	// Takes O(1) time.
+	std::size_t size() const noexcept { return heap.size(); }
+
+	// Returns the kept items in sorted order
+	// Takes O(k log k) time.
+	std::vector<T> to_vector() const {
+		std::vector<T> sorted = heap;
+		std::sort_heap(sorted.begin(), sorted.end(), comp);
+		return sorted;
+	}
+protected:
+	std::size_t limit;
+	Compare comp;
+	std::vector<T> heap;
+};
@@ -0,0 +1,726 @@
+// Micro-benchmarks for every container and sort, against their std:: equivalents
+// Usage: pz_benchmark [--format csv|json] [--sizes 1024,65536] [--filter text]
+// Prints one record per benchmark, container, key distribution and size with ns/op, ops/s and allocations/op.
+#include "algorithms/sort.h"
+#include "data-structures/b_plus_tree.h"
+#include "data-structures/binary_search_tree.h"
+#include "data-structures/concurrent_search_tree.h"
+#include "data-structures/d_ary_heap.h"
+#include "data-structures/dynamic_array.h"
+#include "data-structures/heap_array.h"
+#include "data-structures/memory_resource.h"
+#include "data-structures/segmented_array.h"
+#include "data-structures/singly_linked_list.h"
+#include "data-structures/stack.h"
+#include "data-structures/vector_stack.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <new>
+#include <queue>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//// Allocation counting
+// Every global allocation in the process goes through here, so each benchmark can report allocations per operation.
+static std::size_t allocation_count = 0;
+
+void* operator new(std::size_t size) {
+	++allocation_count;
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Memory resources allocate through the aligned forms
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	++allocation_count;
+	const auto align = static_cast<std::size_t>(alignment);
+	if (void* ptr = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+namespace {
+	// Results are folded into this so the compiler cannot drop the work being timed
+	volatile std::size_t sink = 0;
+
+	// Containers whose operations here are O(n) each are skipped above this size
+	constexpr std::size_t quadratic_limit = std::size_t(1) << 14;
+
+	// Each measurement repeats until it has run at least this many operations or for this long
+	constexpr std::size_t min_ops = std::size_t(1) << 20;
+	constexpr std::chrono::milliseconds min_time{ 200 };
+
+	struct result {
+		std::string benchmark, container, distribution;
+		std::size_t size;
+		double ns_per_op, ops_per_sec, allocs_per_op;
+	};
+
+	struct options {
+		bool json = false;
+		std::vector<std::size_t> sizes = { std::size_t(1) << 10, std::size_t(1) << 14, std::size_t(1) << 18 };
+		std::string filter;
+	};
+
+	const char* const distributions[] = { "random", "sorted", "reversed", "few_unique" };
+
+	// Keys of the given distribution, the same for every container
+	std::vector<unsigned int> make_keys(const std::string& distribution, const std::size_t size) {
+		std::mt19937 gen(12345);
+		std::vector<unsigned int> keys(size);
+		for (auto& key : keys)
+			key = (distribution == "few_unique") ? gen() % 16 : gen();
+		if (distribution == "sorted")
+			std::sort(keys.begin(), keys.end());
+		else if (distribution == "reversed")
+			std::sort(keys.begin(), keys.end(), std::greater<>());
+		return keys;
+	}
+
+	struct runner {
+		options opts;
+		std::vector<result> results;
+
+		// Times [body], which performs [ops] operations per call, repeating it until min_ops operations or min_time
+		// [setup] runs untimed before every repetition.
+		template <typename Setup, typename Body>
+		void measure(const std::string& benchmark, const std::string& container, const std::string& distribution,
+			const std::size_t size, const std::size_t ops, Setup setup, Body body) {
+			const std::string name = benchmark + "/" + container + "/" + distribution;
+			if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+				return;
+
+			const std::size_t reps = std::max<std::size_t>(1, min_ops / std::max<std::size_t>(ops, 1));
+			std::chrono::nanoseconds elapsed{ 0 };
+			std::size_t allocations = 0, r = 0;
+			for (; r < reps && (r == 0 || elapsed < min_time); ++r) {
+				setup();
+				const std::size_t allocations_before = allocation_count;
+				const auto start = std::chrono::steady_clock::now();
+				body();
+				elapsed += std::chrono::steady_clock::now() - start;
+				allocations += allocation_count - allocations_before;
+			}
+			const double total_ops = double(r) * double(ops);
+			const double ns = double(elapsed.count()) / total_ops;
+			results.push_back({ benchmark, container, distribution, size, ns, ns > 0 ? 1e9 / ns : 0.0, double(allocations) / total_ops });
+		}
+
+		// Times [body] like measure, but takes the allocations from [count] rather than the operator new hooks
+		// [count] runs once, untimed and after [setup], doing the same work on containers with counting_stats, and returns
+		// the allocations they recorded. pz::dynamic_arrays of trivially copyable elements grow with malloc and realloc,
+		// which the hooks never see.
+		template <typename Setup, typename Body, typename Count>
+		void measure_counted(const std::string& benchmark, const std::string& container, const std::string& distribution,
+			const std::size_t size, const std::size_t ops, Setup setup, Body body, Count count) {
+			const std::size_t measured = results.size();
+			measure(benchmark, container, distribution, size, ops, setup, body);
+			if (results.size() == measured)
+				return;
+			setup();
+			results.back().allocs_per_op = double(count()) / double(std::max<std::size_t>(ops, 1));
+		}
+
+		void print() const {
+			if (opts.json) {
+				std::printf("[\n");
+				for (std::size_t i = 0; i < results.size(); ++i) {
+					const auto& r = results[i];
+					std::printf("  {\"benchmark\": \"%s\", \"container\": \"%s\", \"distribution\": \"%s\", \"size\": %zu, "
+						"\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.4f}%s\n",
+						r.benchmark.c_str(), r.container.c_str(), r.distribution.c_str(), r.size,
+						r.ns_per_op, r.ops_per_sec, r.allocs_per_op, (i + 1 < results.size()) ? "," : "");
+				}
+				std::printf("]\n");
+			}
+			else {
+				std::printf("benchmark,container,distribution,size,ns_per_op,ops_per_sec,allocs_per_op\n");
+				for (const auto& r : results)
+					std::printf("%s,%s,%s,%zu,%.3f,%.1f,%.4f\n", r.benchmark.c_str(), r.container.c_str(), r.distribution.c_str(),
+						r.size, r.ns_per_op, r.ops_per_sec, r.allocs_per_op);
+			}
+		}
+	};
+
+	const auto no_setup = [] {};
+
+	// push_back/append and push/pop
+	void bench_push_pop(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+
+		const auto push_back = [&](auto stats) {
+			pz::dynamic_array<unsigned int, decltype(stats)> arr;
+			for (auto key : keys)
+				arr.push_back(key);
+			sink += arr.size();
+			return arr.stats().allocations;
+		};
+		run.measure_counted("push_back", "pz::dynamic_array", dist, n, n, no_setup,
+			[&] { push_back(pz::no_stats{}); }, [&] { return push_back(pz::counting_stats{}); });
+		run.measure("push_back", "std::vector", dist, n, n, no_setup, [&] {
+			std::vector<unsigned int> vec;
+			for (auto key : keys)
+				vec.push_back(key);
+			sink += vec.size();
+		});
+		run.measure("push_back", "pz::segmented_array", dist, n, n, no_setup, [&] {
+			pz::segmented_array<unsigned int> arr;
+			for (auto key : keys)
+				arr.push_back(key);
+			sink += arr.size();
+		});
+
+		// Plain 64 byte records, where growth is dominated by relocating the bytes
+		struct record {
+			unsigned int key;
+			unsigned int payload[15];
+		};
+		const auto push_back_record = [&](auto stats) {
+			pz::dynamic_array<record, decltype(stats)> arr;
+			for (auto key : keys)
+				arr.push_back(record{ key, {} });
+			sink += arr.size();
+			return arr.stats().allocations;
+		};
+		run.measure_counted("push_back_record", "pz::dynamic_array", dist, n, n, no_setup,
+			[&] { push_back_record(pz::no_stats{}); }, [&] { return push_back_record(pz::counting_stats{}); });
+		run.measure("push_back_record", "std::vector", dist, n, n, no_setup, [&] {
+			std::vector<record> vec;
+			for (auto key : keys)
+				vec.push_back(record{ key, {} });
+			sink += vec.size();
+		});
+		run.measure("push_back_record", "pz::segmented_array", dist, n, n, no_setup, [&] {
+			pz::segmented_array<record> arr;
+			for (auto key : keys)
+				arr.push_back(record{ key, {} });
+			sink += arr.size();
+		});
+
+		// Many short-lived arrays of a few elements each
+		constexpr std::size_t small_length = 8;
+		// Called with an empty array of the type to time, or of its counting_stats twin
+		const auto push_back_small = [&](const auto& empty) {
+			std::size_t allocations = 0;
+			for (std::size_t start = 0; start < n; start += small_length) {
+				std::decay_t<decltype(empty)> arr;
+				for (std::size_t i = start; i < std::min(n, start + small_length); ++i)
+					arr.push_back(keys[i]);
+				sink += arr.size();
+				allocations += arr.stats().allocations;
+			}
+			return allocations;
+		};
+		run.measure_counted("push_back_small", "pz::small_array", dist, n, n, no_setup,
+			[&] { push_back_small(pz::small_array<unsigned int, 16>()); },
+			[&] { return push_back_small(pz::small_array<unsigned int, 16, pz::counting_stats>()); });
+		run.measure_counted("push_back_small", "pz::dynamic_array", dist, n, n, no_setup,
+			[&] { push_back_small(pz::dynamic_array<unsigned int>()); },
+			[&] { return push_back_small(pz::dynamic_array<unsigned int, pz::counting_stats>()); });
+		run.measure("push_back_small", "std::vector", dist, n, n, no_setup, [&] {
+			for (std::size_t start = 0; start < n; start += small_length) {
+				std::vector<unsigned int> vec;
+				for (std::size_t i = start; i < std::min(n, start + small_length); ++i)
+					vec.push_back(keys[i]);
+				sink += vec.size();
+			}
+		});
+		if (n <= quadratic_limit) {
+			run.measure("push_back", "slist", dist, n, n, no_setup, [&] {
+				slist<unsigned int> list;
+				for (auto key : keys)
+					list.append(key);
+				sink += list.size();
+			});
+		}
+		run.measure("push_back", "std::list", dist, n, n, no_setup, [&] {
+			std::list<unsigned int> list;
+			for (auto key : keys)
+				list.push_back(key);
+			sink += list.size();
+		});
+
+		// A push and a pop of every key count as two operations
+		run.measure("push_pop", "pz::stack", dist, n, 2 * n, no_setup, [&] {
+			pz::stack<unsigned int> stack;
+			for (auto key : keys)
+				stack.push(key);
+			while (!stack.empty())
+				sink += stack.pop();
+		});
+		run.measure("push_pop", "pz::stack_monotonic_arena", dist, n, 2 * n, no_setup, [&] {
+			pz::monotonic_arena arena;
+			pz::stack<unsigned int> stack(&arena);
+			for (auto key : keys)
+				stack.push(key);
+			while (!stack.empty())
+				sink += stack.pop();
+		});
+		run.measure("push_pop", "pz::vector_stack", dist, n, 2 * n, no_setup, [&] {
+			pz::vector_stack<unsigned int> stack;
+			for (auto key : keys)
+				stack.push(key);
+			while (stack.size())
+				sink += stack.pop();
+		});
+		run.measure("push_pop", "std::stack", dist, n, 2 * n, no_setup, [&] {
+			std::stack<unsigned int, std::vector<unsigned int>> stack;
+			for (auto key : keys)
+				stack.push(key);
+			while (!stack.empty()) {
+				sink += stack.top();
+				stack.pop();
+			}
+		});
+	}
+
+	// insert, find and remove on the ordered containers
+	void bench_tree(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		run.measure("insert", "bst_self_balance", dist, n, n, no_setup, [&] {
+			bst<unsigned int> tree;
+			tree.self_balance(0.7);
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+
+		run.measure("insert", "bplus_tree", dist, n, n, no_setup, [&] {
+			bplus_tree<unsigned int> tree;
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+		bplus_tree<unsigned int> wide_tree;
+		for (auto key : keys)
+			wide_tree.add(key);
+		run.measure("find", "bplus_tree", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += (wide_tree.find(key) != nullptr);
+		});
+		bplus_tree<unsigned int>* removing_wide = nullptr;
+		run.measure("remove", "bplus_tree", dist, n, n, [&] {
+			delete removing_wide;
+			removing_wide = new bplus_tree<unsigned int>();
+			for (auto key : keys)
+				removing_wide->add(key);
+		}, [&] {
+			for (auto key : keys)
+				removing_wide->remove(key);
+			sink += removing_wide->size();
+		});
+		delete removing_wide;
+
+		// Sorted input turns bst into a linked list
+		if (n > quadratic_limit && (dist == "sorted" || dist == "reversed" || dist == "few_unique"))
+			return;
+
+		run.measure("insert", "bst", dist, n, n, no_setup, [&] {
+			bst<unsigned int> tree;
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+		run.measure("insert", "bst_monotonic_arena", dist, n, n, no_setup, [&] {
+			pz::monotonic_arena arena;
+			bst<unsigned int> tree(&arena);
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+		run.measure("insert", "bst_thread_local_pool", dist, n, n, no_setup, [&] {
+			bst<unsigned int> tree(pz::thread_local_pool());
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+		run.measure("insert", "arena_bst", dist, n, n, no_setup, [&] {
+			arena_bst<unsigned int> tree;
+			for (auto key : keys)
+				tree.add(key);
+			sink += tree.size();
+		});
+		run.measure("insert", "std::multiset", dist, n, n, no_setup, [&] {
+			std::multiset<unsigned int> tree;
+			for (auto key : keys)
+				tree.insert(key);
+			sink += tree.size();
+		});
+
+		bst<unsigned int> tree;
+		arena_bst<unsigned int> arena_tree;
+		std::multiset<unsigned int> set;
+		for (auto key : keys) {
+			tree.add(key);
+			arena_tree.add(key);
+			set.insert(key);
+		}
+		run.measure("find", "bst", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += (tree.find(key) != nullptr);
+		});
+		run.measure("find", "arena_bst", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += (arena_tree.find(key) != nullptr);
+		});
+		const auto frozen = tree.freeze();
+		run.measure("find", "frozen_bst", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += (frozen.find(key) != nullptr);
+		});
+		std::vector<const unsigned int*> found(n);
+		run.measure("find", "frozen_bst_batched", dist, n, n, no_setup, [&] {
+			frozen.find_many(keys.data(), n, found.data());
+			sink += (found[0] != nullptr);
+		});
+		run.measure("find", "std::multiset", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += (set.find(key) != set.end());
+		});
+		concurrent_bst<unsigned int> shared_tree;
+		for (auto key : keys)
+			shared_tree.add(key);
+		run.measure("find", "concurrent_bst", dist, n, n, no_setup, [&] {
+			for (auto key : keys)
+				sink += shared_tree.contains(key);
+		});
+		run.measure("find", "concurrent_bst_guarded", dist, n, n, no_setup, [&] {
+			const auto guard = shared_tree.read();
+			for (auto key : keys)
+				sink += (guard.find(key) != nullptr);
+		});
+
+		// Removal timing excludes building the tree that is removed from
+		bst<unsigned int>* removing = nullptr;
+		run.measure("remove", "bst", dist, n, n, [&] {
+			delete removing;
+			removing = new bst<unsigned int>();
+			for (auto key : keys)
+				removing->add(key);
+		}, [&] {
+			for (auto key : keys)
+				removing->remove(key);
+			sink += removing->size();
+		});
+		delete removing;
+		std::multiset<unsigned int> removing_set;
+		run.measure("remove", "std::multiset", dist, n, n, [&] {
+			removing_set = std::multiset<unsigned int>(keys.begin(), keys.end());
+		}, [&] {
+			for (auto key : keys)
+				removing_set.erase(removing_set.find(key));
+			sink += removing_set.size();
+		});
+	}
+
+	// Full traversal of every element
+	void bench_iterate(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+
+		pz::dynamic_array<unsigned int> arr;
+		std::vector<unsigned int> vec;
+		std::list<unsigned int> list;
+		for (auto key : keys) {
+			arr.push_back(key);
+			vec.push_back(key);
+			list.push_back(key);
+		}
+		run.measure("iterate", "pz::dynamic_array", dist, n, n, no_setup, [&] {
+			std::size_t sum = 0;
+			for (auto key : arr)
+				sum += key;
+			sink += sum;
+		});
+		run.measure("iterate", "std::vector", dist, n, n, no_setup, [&] {
+			std::size_t sum = 0;
+			for (auto key : vec)
+				sum += key;
+			sink += sum;
+		});
+		run.measure("iterate", "std::list", dist, n, n, no_setup, [&] {
+			std::size_t sum = 0;
+			for (auto key : list)
+				sum += key;
+			sink += sum;
+		});
+		bplus_tree<unsigned int> wide_tree;
+		for (auto key : keys)
+			wide_tree.add(key);
+		run.measure("iterate", "bplus_tree", dist, n, n, no_setup, [&] {
+			std::size_t sum = 0;
+			for (auto key : wide_tree)
+				sum += key;
+			sink += sum;
+		});
+		if (n <= quadratic_limit) {
+			slist<unsigned int> slist_keys;
+			for (auto key : keys)
+				slist_keys.append(key);
+			run.measure("iterate", "slist", dist, n, n, no_setup, [&] {
+				std::size_t sum = 0;
+				for (auto key : slist_keys)
+					sum += key;
+				sink += sum;
+			});
+		}
+		if (n <= quadratic_limit || dist == "random") {
+			bst<unsigned int> tree;
+			std::multiset<unsigned int> set(keys.begin(), keys.end());
+			for (auto key : keys)
+				tree.add(key);
+			run.measure("iterate", "bst", dist, n, n, no_setup, [&] {
+				std::size_t sum = 0;
+				for (auto key : tree)
+					sum += key;
+				sink += sum;
+			});
+			run.measure("iterate", "std::multiset", dist, n, n, no_setup, [&] {
+				std::size_t sum = 0;
+				for (auto key : set)
+					sum += key;
+				sink += sum;
+			});
+		}
+	}
+
+	// Sorting a copy of the keys, with the copy made outside the timing
+	void bench_sort(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		std::vector<unsigned int> data;
+		const auto reset = [&] { data = keys; };
+
+		run.measure("sort", "radix_sort", dist, n, n, reset, [&] {
+			radix_sort(data);
+			sink += data[0];
+		});
+		run.measure("sort", "parallel_radix_sort", dist, n, n, reset, [&] {
+			parallel_radix_sort(data);
+			sink += data[0];
+		});
+		run.measure("sort", "intro_sort", dist, n, n, reset, [&] {
+			intro_sort(data.begin(), data.end());
+			sink += data[0];
+		});
+		run.measure("sort", "std::sort", dist, n, n, reset, [&] {
+			std::sort(data.begin(), data.end());
+			sink += data[0];
+		});
+	}
+
+	// Numeric scans over an aligned buffer with each instruction set the SIMD kernels can use
+	void bench_simd(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		pz::aligned_heap_array<float> values{ int(n) };
+		for (std::size_t i = 0; i < n; ++i)
+			values[i] = float(keys[i] % 1000);
+
+		const std::pair<pz::simd::isa, const char*> levels[] = {
+			{ pz::simd::isa::scalar, "pz::simd scalar" }, { pz::simd::isa::sse2, "pz::simd sse2" },
+			{ pz::simd::isa::avx2, "pz::simd avx2" }, { pz::simd::isa::avx512, "pz::simd avx512" } };
+		const auto best = pz::simd::detect();
+		for (const auto& level : levels) {
+			if (level.first > best)
+				continue;
+			pz::simd::use(level.first);
+			run.measure("sum", level.second, dist, n, n, no_setup, [&] { sink += std::size_t(values.sum()); });
+			run.measure("count_if", level.second, dist, n, n, no_setup, [&] {
+				sink += values.count_if([](float x) { return x < 500; });
+			});
+		}
+		pz::simd::use(best);
+
+		std::vector<float> vec(values.begin(), values.end());
+		run.measure("sum", "std::accumulate", dist, n, n, no_setup, [&] { sink += std::size_t(std::accumulate(vec.begin(), vec.end(), 0.f)); });
+		run.measure("count_if", "std::count_if", dist, n, n, no_setup, [&] {
+			sink += std::size_t(std::count_if(vec.begin(), vec.end(), [](float x) { return x < 500; }));
+		});
+	}
+
+	// Taking many small slices, copied by sub_array against viewed by slice
+	void bench_slice(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		constexpr std::size_t width = 16;
+		if (n < width)
+			return;
+		pz::dynamic_array<unsigned int> arr;
+		pz::dynamic_array<unsigned int, pz::counting_stats> counted;
+		for (auto key : keys) {
+			arr.push_back(key);
+			counted.push_back(key);
+		}
+
+		const auto sub_arrays = [&](const auto& source) {
+			std::size_t sum = 0, allocations = 0;
+			for (std::size_t i = 0; i + width <= n; ++i) {
+				const auto sub = source.sub_array(i, i + width);
+				sum += sub[width / 2];
+				allocations += sub.stats().allocations;
+			}
+			sink += sum;
+			return allocations;
+		};
+		run.measure_counted("slice", "pz::dynamic_array::sub_array", dist, n, n, no_setup,
+			[&] { sub_arrays(arr); }, [&] { return sub_arrays(counted); });
+		run.measure("slice", "pz::dynamic_array::slice", dist, n, n, no_setup, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i + width <= n; ++i)
+				sum += arr.slice(i, i + width)[width / 2];
+			sink += sum;
+		});
+	}
+
+	// Pushing every key then popping them all, and lowering keys in place as Dijkstra's algorithm does
+	template <std::size_t Arity>
+	void bench_d_ary_heap(runner& run, const std::vector<unsigned int>& keys, const std::string& dist, const char* name) {
+		const std::size_t n = keys.size();
+		// Its storage comes from malloc, which the allocation count can't see, so it is reserved untimed and the
+		// timed pushes and pops really make no allocations
+		pz::d_ary_heap<unsigned int, Arity> heap;
+		run.measure("heap_push_pop", name, dist, n, 2 * n, [&] { heap.reserve(n); }, [&] {
+			for (auto key : keys)
+				heap.push(key);
+			std::size_t sum = 0;
+			while (!heap.empty())
+				sum += heap.pop();
+			sink += sum;
+		});
+		run.measure("decrease_key", name, dist, n, 2 * n, [&] {
+			heap.clear();
+			for (auto key : keys)
+				heap.push(key);
+		}, [&] {
+			for (std::size_t i = 0; i < n; ++i)
+				heap.decrease_key(i, keys[i] / 2);
+			sink += heap.top();
+		});
+	}
+
+	void bench_priority_queue(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		bench_d_ary_heap<2>(run, keys, dist, "pz::d_ary_heap<2>");
+		bench_d_ary_heap<4>(run, keys, dist, "pz::d_ary_heap<4>");
+		bench_d_ary_heap<8>(run, keys, dist, "pz::d_ary_heap<8>");
+
+		run.measure("heap_push_pop", "std::priority_queue", dist, n, 2 * n, no_setup, [&] {
+			std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<>> queue;
+			for (auto key : keys)
+				queue.push(key);
+			std::size_t sum = 0;
+			while (!queue.empty()) {
+				sum += queue.top();
+				queue.pop();
+			}
+			sink += sum;
+		});
+
+		// Without handles, a key is lowered by erasing and reinserting it in an ordered set
+		std::multiset<std::pair<unsigned int, std::size_t>> set;
+		run.measure("decrease_key", "std::multiset", dist, n, 2 * n, [&] {
+			set.clear();
+			for (std::size_t i = 0; i < n; ++i)
+				set.emplace(keys[i], i);
+		}, [&] {
+			for (std::size_t i = 0; i < n; ++i) {
+				set.erase(set.find({ keys[i], i }));
+				set.emplace(keys[i] / 2, i);
+			}
+			sink += set.begin()->first;
+		});
+	}
+
+	// Binary snapshot and restore, and text dumps through to_chars against iostreams
+	void bench_serialize(runner& run, const std::vector<unsigned int>& keys, const std::string& dist) {
+		const std::size_t n = keys.size();
+		pz::dynamic_array<unsigned int> arr;
+		for (auto key : keys)
+			arr.push_back(key);
+		std::vector<char> bytes;
+
+		run.measure("serialize", "pz::dynamic_array", dist, n, n, [&] { bytes.clear(); }, [&] {
+			pz::buffer_sink out(bytes);
+			arr.serialize(out);
+			out.finish();
+			sink += bytes.size();
+		});
+		const auto deserialize = [&](auto stats) {
+			pz::buffer_source in(bytes);
+			const auto restored = pz::dynamic_array<unsigned int, decltype(stats)>::deserialize(in);
+			sink += restored.size();
+			return restored.stats().allocations;
+		};
+		run.measure_counted("deserialize", "pz::dynamic_array", dist, n, n, no_setup,
+			[&] { deserialize(pz::no_stats{}); }, [&] { return deserialize(pz::counting_stats{}); });
+		run.measure("write_text", "pz::dynamic_array", dist, n, n, [&] { bytes.clear(); }, [&] {
+			pz::buffer_sink out(bytes);
+			arr.write_text(out);
+			out.finish();
+			sink += bytes.size();
+		});
+		run.measure("write_text", "std::ostringstream", dist, n, n, no_setup, [&] {
+			std::ostringstream out;
+			out << arr;
+			sink += out.str().size();
+		});
+	}
+
+	// Parses a comma separated list of sizes
+	std::vector<std::size_t> parse_sizes(const char* text) {
+		std::vector<std::size_t> sizes;
+		for (char* end = nullptr; *text; text = (*end == ',') ? end + 1 : end) {
+			sizes.push_back(std::strtoull(text, &end, 10));
+			if (end == text)
+				break;
+		}
+		return sizes;
+	}
+}
+
+int main(int argc, char** argv) {
+	runner run;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+			run.opts.json = std::strcmp(argv[++i], "json") == 0;
+		else if (arg == "--sizes" && i + 1 < argc)
+			run.opts.sizes = parse_sizes(argv[++i]);
+		else if (arg == "--filter" && i + 1 < argc)
+			run.opts.filter = argv[++i];
+		else {
+			std::fprintf(stderr, "Usage: %s [--format csv|json] [--sizes 1024,65536] [--filter text]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (const auto size : run.opts.sizes) {
+		if (!size)
+			continue;
+		for (const char* dist : distributions) {
+			const auto keys = make_keys(dist, size);
+			bench_push_pop(run, keys, dist);
+			bench_tree(run, keys, dist);
+			bench_iterate(run, keys, dist);
+			bench_sort(run, keys, dist);
+			bench_slice(run, keys, dist);
+			bench_priority_queue(run, keys, dist);
+			bench_simd(run, keys, dist);
+			bench_serialize(run, keys, dist);
+		}
+	}
+	run.print();
+	return 0;
+}
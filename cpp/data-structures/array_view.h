@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace pz {
+	template <typename T>
+	struct array_view;
+
+	template <typename T>
+	struct is_array_view : std::false_type {};
+	template <typename T>
+	struct is_array_view<array_view<T>> : std::true_type {};
+
+	// Non-owning view of evenly spaced elements in an array, such as a slice of a dynamic_array
+	// Slicing, reversing and striding make a new view in O(1) time without copying or allocating,
+	// so the viewed array must outlive the view and not reallocate while it is in use.
+	// Element access is only bounds checked in debug builds. Use a view of const T for read-only access.
+	template <typename T>
+	struct array_view {
+		using value_type = std::remove_cv_t<T>;
+
+		// Random access iterator stepping [stride] elements at a time
+		// Positions are kept as an index from the view's first element, so iterators of reversed views
+		// never point before the start of the array.
+		struct iterator {
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = std::remove_cv_t<T>;
+			using pointer = T*;
+			using reference = T&;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+			iterator(T* first, const std::ptrdiff_t stride, const std::ptrdiff_t index) : first(first), stride(stride), index(index) {}
+
+			reference operator*() const { return first[index * stride]; }
+			pointer operator->() const { return first + index * stride; }
+			reference operator[](const difference_type offset) const { return first[(index + offset) * stride]; }
+
+			iterator& operator++() { ++index; return *this; }
+			iterator operator++(int) { iterator temp = *this; ++index; return temp; }
+			iterator& operator--() { --index; return *this; }
+			iterator operator--(int) { iterator temp = *this; --index; return temp; }
+			iterator& operator+=(const difference_type offset) { index += offset; return *this; }
+			iterator& operator-=(const difference_type offset) { index -= offset; return *this; }
+			friend iterator operator+(iterator it, const difference_type offset) { return it += offset; }
+			friend iterator operator+(const difference_type offset, iterator it) { return it += offset; }
+			friend iterator operator-(iterator it, const difference_type offset) { return it -= offset; }
+			friend difference_type operator-(const iterator& a, const iterator& b) { return a.index - b.index; }
+
+			bool operator==(const iterator& other) const { return index == other.index; }
+			bool operator!=(const iterator& other) const { return index != other.index; }
+			bool operator<(const iterator& other) const { return index < other.index; }
+			bool operator>(const iterator& other) const { return index > other.index; }
+			bool operator<=(const iterator& other) const { return index <= other.index; }
+			bool operator>=(const iterator& other) const { return index >= other.index; }
+		private:
+			T* first = nullptr;
+			std::ptrdiff_t stride = 1;
+			std::ptrdiff_t index = 0;
+		};
+		using const_iterator = iterator;
+
+		array_view() = default;
+
+		// Views [count] contiguous elements starting at [data]
+		array_view(T* data, const std::size_t count) noexcept : first(data), count(count) {}
+
+		// Views [count] elements starting at [data] and [stride] elements apart, e.g. a column of a row-major matrix
+		// A negative stride walks backwards from [data].
+		array_view(T* data, const std::size_t count, const std::ptrdiff_t stride) noexcept : first(data), count(count), step(stride) {}
+
+		// Views the whole of a contiguous container with data() and size(), e.g. std::vector or pz::dynamic_array
+		template <typename Container, typename = std::enable_if_t<!is_array_view<std::remove_cv_t<Container>>::value
+			&& std::is_convertible<decltype(std::declval<Container&>().data()), T*>::value>>
+		array_view(Container& container) : first(container.data()), count(container.size()) {}
+
+		// Views of T can be used as views of const T
+		template <typename U, typename = std::enable_if_t<std::is_convertible<U(*)[], T(*)[]>::value && !std::is_same<U, T>::value>>
+		array_view(const array_view<U>& other) noexcept : first(other.data()), count(other.size()), step(other.stride()) {}
+
+		// Returns the element at [index]
+		// Only bounds checked in debug builds, throwing std::out_of_range there.
+		// Takes O(1) time.
+		T& operator[](const std::size_t index) const {
+#ifndef NDEBUG
+			if (index >= count)
+				throw std::out_of_range("Index out of range");
+#endif
+			return first[std::ptrdiff_t(index) * step];
+		}
+
+		// Returns the element at [index], bounds checked in every build
+		// Takes O(1) time.
+		T& at(const std::size_t index) const {
+			if (index >= count)
+				throw std::out_of_range("Index out of range");
+			return first[std::ptrdiff_t(index) * step];
+		}
+
+		T& front() const { return (*this)[0]; }
+		T& back() const { return (*this)[count - 1]; }
+
+		iterator begin() const noexcept { return iterator(first, step, 0); }
+		iterator end() const noexcept { return iterator(first, step, std::ptrdiff_t(count)); }
+
+		// Returns the number of elements in the view.
+		// Takes O(1) time.
+		std::size_t size() const noexcept { return count; }
+
+		// Returns whether the view is empty.
+		// Takes O(1) time.
+		bool empty() const noexcept { return !count; }
+
+		// Returns the first element's address, the start of the elements in memory only if contiguous()
+		// Takes O(1) time.
+		T* data() const noexcept { return first; }
+
+		// Returns the distance between neighbouring elements of the view in the underlying array
+		// Takes O(1) time.
+		std::ptrdiff_t stride() const noexcept { return step; }
+
+		// Returns whether the elements are next to each other in memory, in order
+		// Takes O(1) time.
+		bool contiguous() const noexcept { return step == 1; }
+
+		// Returns a view from inclusive start to exclusive end
+		// Takes O(1) time.
+		array_view slice(const std::size_t start, const std::size_t end) const {
+			if (start > end || end > count)
+				throw std::out_of_range("Index out of range");
+			// An empty slice keeps the current first element, as stepping [start] elements along a reversed or strided view
+			// could point outside the array
+			if (start == end)
+				return array_view(first, 0, step);
+			return array_view(first + std::ptrdiff_t(start) * step, end - start, step);
+		}
+
+		// Returns a view of the same elements in reverse order
+		// Takes O(1) time.
+		array_view reversed() const noexcept {
+			if (!count)
+				return *this;
+			return array_view(first + std::ptrdiff_t(count - 1) * step, count, -step);
+		}
+
+		// Returns a view of every [every]th element, starting with the first
+		// Takes O(1) time.
+		array_view strided(const std::size_t every) const {
+			if (!every)
+				throw std::invalid_argument("Stride must be positive");
+			// Rounds up without computing count + every - 1, which can overflow for a huge [every]
+			const std::size_t kept = count / every + (count % every != 0);
+			// With at most one element left the stride is never used, and multiplying by a huge [every] could overflow
+			return array_view(first, kept, kept > 1 ? step * std::ptrdiff_t(every) : step);
+		}
+
+		// Copy all elements into a vector, for when the view has to own them.
+		// Takes O(n) time.
+		std::vector<value_type> to_vector() const { return std::vector<value_type>(begin(), end()); }
+	private:
+		T* first = nullptr;
+		std::size_t count = 0;
+		std::ptrdiff_t step = 1;
+	};
+}
@@ -0,0 +1,532 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Counts the keys of a node that come before a search key, with a binary search
+// Used for keys that aren't plain numbers, where comparisons cost more than the branches.
+template <typename Key, typename Enable = void>
+struct bplus_search {
+	// Number of keys less than [item]
+	static unsigned count_less(const Key* keys, const unsigned n, const Key& item) {
+		return unsigned(std::lower_bound(keys, keys + n, item) - keys);
+	}
+
+	// Number of keys not greater than [item]
+	static unsigned count_not_greater(const Key* keys, const unsigned n, const Key& item) {
+		return unsigned(std::upper_bound(keys, keys + n, item) - keys);
+	}
+};
+
+// Counts the keys of a node that come before a search key, with a branchless scan of the whole node
+// A node is only a few cache lines, so comparing every key beats the mispredicted branches of a binary search.
+// 32-bit keys are compared four at a time with SSE2, other sizes in a loop the compiler can vectorise.
+template <typename Key>
+struct bplus_search<Key, std::enable_if_t<std::is_arithmetic<Key>::value>> {
+	// Number of keys less than [item]
+	static unsigned count_less(const Key* keys, const unsigned n, const Key& item) {
+		unsigned i = 0, count = 0;
+#if defined(__SSE2__)
+		if constexpr (sizeof(Key) == 4)
+			for (; i + 4 <= n; i += 4)
+				count += lanes(less_mask(keys + i, item, true));
+#endif
+		for (; i < n; ++i)
+			count += (keys[i] < item);
+		return count;
+	}
+
+	// Number of keys not greater than [item]
+	static unsigned count_not_greater(const Key* keys, const unsigned n, const Key& item) {
+		unsigned i = 0, count = 0;
+#if defined(__SSE2__)
+		if constexpr (sizeof(Key) == 4)
+			for (; i + 4 <= n; i += 4)
+				count += 4 - lanes(less_mask(keys + i, item, false));
+#endif
+		for (; i < n; ++i)
+			count += !(item < keys[i]);
+		return count;
+	}
+private:
+#if defined(__SSE2__)
+	// Bit per lane of the four keys at [keys] where key < item, or item < key when [keys_first] is false
+	static int less_mask(const Key* keys, const Key& item, const bool keys_first) {
+		if constexpr (std::is_floating_point<Key>::value) {
+			const __m128 block = _mm_loadu_ps(keys), pivot = _mm_set1_ps(item);
+			return _mm_movemask_ps(keys_first ? _mm_cmplt_ps(block, pivot) : _mm_cmplt_ps(pivot, block));
+		}
+		else {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+			__m128i pivot = _mm_set1_epi32(static_cast<int>(item));
+			// SSE2 only compares signed lanes, so flipping the sign bit puts unsigned keys in signed order
+			if constexpr (std::is_unsigned<Key>::value) {
+				const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+				block = _mm_xor_si128(block, bias);
+				pivot = _mm_xor_si128(pivot, bias);
+			}
+			return _mm_movemask_ps(_mm_castsi128_ps(keys_first ? _mm_cmplt_epi32(block, pivot) : _mm_cmplt_epi32(pivot, block)));
+		}
+	}
+
+	// Number of bits set in a four lane mask
+	static unsigned lanes(const int mask) {
+		static constexpr unsigned char bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+		return bits[mask];
+	}
+#endif
+};
+
+// Values stored alongside the keys of a bplus_tree leaf, nothing when the tree is a set
+template <typename Value, std::size_t N>
+struct bplus_leaf_values {
+	Value values[N];
+};
+template <std::size_t N>
+struct bplus_leaf_values<void, N> {};
+
+template <typename Key, typename Value = void, std::size_t NodeBytes = 256>
+// B+ tree with many keys per node, an ordered set, or an ordered map from Key to [Value] when one is given
+// Nodes are [NodeBytes] wide, a few cache lines, so the tree stays a handful of levels tall even with tens of millions of keys,
+// and each level costs one short scan of a node rather than a cache miss per key as in bst.
+// Values live only in the leaves, which are linked in order so a scan reads them front to back.
+// Like bst, equal keys are kept side by side. Keys must be default constructible and comparable
+struct bplus_tree {
+	static constexpr bool is_map = !std::is_void<Value>::value;
+
+	// What a lookup points at, the value for a map and the key for a set
+	using found_type = std::conditional_t<is_map, Value, const Key>;
+
+	// What to_vector lists, key and value pairs for a map and keys for a set
+	using value_type = std::conditional_t<is_map, std::pair<Key, Value>, Key>;
+private:
+	static constexpr std::size_t value_bytes() {
+		if constexpr (is_map)
+			return sizeof(Value);
+		else
+			return 0;
+	}
+	using search = bplus_search<Key>;
+public:
+	// Keys held by each leaf and each inner node, filling [NodeBytes] after the count and link fields
+	static constexpr unsigned leaf_capacity = unsigned(std::max<std::size_t>(4, (NodeBytes - 2 * sizeof(void*)) / (sizeof(Key) + value_bytes())));
+	static constexpr unsigned inner_capacity = unsigned(std::max<std::size_t>(4, (NodeBytes - 2 * sizeof(void*)) / (sizeof(Key) + sizeof(void*))));
+private:
+	struct node {
+		// Number of keys held
+		unsigned count = 0;
+	};
+
+	struct alignas(64) leaf : node, bplus_leaf_values<Value, leaf_capacity> {
+		// Next leaf in key order
+		leaf* next = nullptr;
+
+		Key keys[leaf_capacity];
+	};
+
+	// Child i holds keys from keys[i - 1] to keys[i], both inclusive as equal keys can straddle a split
+	struct alignas(64) inner : node {
+		Key keys[inner_capacity];
+		node* children[inner_capacity + 1];
+	};
+public:
+	// Forward iterator along the linked leaves
+	struct const_iterator {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Key;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Key*;
+		using reference = const Key&;
+
+		const_iterator() = default;
+		const_iterator(const leaf* at, const unsigned pos) : at(at), pos(pos) {}
+
+		const Key& operator*() const { return at->keys[pos]; }
+		const Key* operator->() const { return &at->keys[pos]; }
+
+		// Key at the iterator, the same as operator*
+		const Key& key() const { return at->keys[pos]; }
+
+		// Value stored with the key, only for maps
+		template <typename V = Value, std::enable_if_t<!std::is_void<V>::value, int> = 0>
+		const V& value() const { return at->values[pos]; }
+
+		// Takes O(1) time.
+		const_iterator& operator++() {
+			if (++pos == at->count) {
+				at = at->next;
+				pos = 0;
+			}
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator==(const const_iterator& other) const { return at == other.at && pos == other.pos; }
+		bool operator!=(const const_iterator& other) const { return !(*this == other); }
+	private:
+		const leaf* at = nullptr;
+		unsigned pos = 0;
+	};
+
+	bplus_tree() = default;
+
+	// Prevent the tree from being copied
+	bplus_tree(const bplus_tree& other) = delete;
+	void operator=(const bplus_tree& other) = delete;
+
+	/// Returns whether the structure is empty
+	// Takes O(1) time.
+	bool empty() const noexcept { return !count; }
+
+	/// Number of elements in the tree.
+	// Takes O(1) time.
+	std::size_t size() const noexcept { return count; }
+
+	// Append a key to the tree, with its value when the tree is a map
+	// A full node splits in two, and a split root grows the tree a level at the top.
+	// Takes O(log n) time.
+	template <typename... V>
+	void add(const Key& item, V&&... value) {
+		static_assert(sizeof...(V) == (is_map ? 1 : 0), "A map takes a key and a value, a set only a key");
+		if (!root)
+			root = first = new leaf();
+		Key separator;
+		node* right;
+		if (insert_into(root, height, item, separator, right, std::forward<V>(value)...)) {
+			inner* top = new inner();
+			top->count = 1;
+			top->keys[0] = std::move(separator);
+			top->children[0] = root;
+			top->children[1] = right;
+			root = top;
+			++height;
+		}
+		++count;
+	}
+
+	// Find a key and return a pointer to its value for a map, or to the key itself for a set
+	// Takes O(log n) time.
+	found_type* find(const Key& item) {
+		const_iterator found = lower_bound(item);
+		if (found == end() || item < *found)
+			return nullptr;
+		if constexpr (is_map)
+			return const_cast<Value*>(&found.value());
+		else
+			return &*found;
+	}
+	const found_type* find(const Key& item) const { return const_cast<bplus_tree*>(this)->find(item); }
+
+	// Returns whether the key is in the tree
+	// Takes O(log n) time.
+	bool contains(const Key& item) const { return find(item) != nullptr; }
+
+	// Remove a single instance of a key, with its value, from the tree
+	// A node left less than half full takes a key from a sibling, or merges with one when neither can spare any.
+	// Takes O(log n) time.
+	void remove(const Key& item) {
+		if (!root || !remove_from(root, height, item))
+			return;
+		--count;
+		// Shrink the tree once the root has a single child, or free it once there is nothing left
+		if (height && !root->count) {
+			inner* top = static_cast<inner*>(root);
+			root = top->children[0];
+			delete top;
+			--height;
+		}
+		else if (!height && !root->count) {
+			delete static_cast<leaf*>(root);
+			root = first = nullptr;
+		}
+	}
+
+	// Finds all keys, or key and value pairs for a map, and outputs them to an ordered vector
+	// Reads the leaves front to back along their links.
+	// Takes O(n) time.
+	std::vector<value_type> to_vector() const {
+		std::vector<value_type> arr;
+		arr.reserve(count);
+		for (const leaf* at = first; at; at = at->next)
+			for (unsigned i = 0; i < at->count; ++i) {
+				if constexpr (is_map)
+					arr.emplace_back(at->keys[i], at->values[i]);
+				else
+					arr.push_back(at->keys[i]);
+			}
+		return arr;
+	}
+
+	// Returns an iterator at the lowest key
+	// Takes O(1) time.
+	const_iterator begin() const { return const_iterator(first, 0); }
+
+	// Returns an iterator past the highest key
+	const_iterator end() const { return const_iterator(); }
+
+	// Returns an iterator at the first key not less than [item]
+	// Takes O(log n) time.
+	const_iterator lower_bound(const Key& item) const {
+		if (!root)
+			return end();
+		const node* at = root;
+		for (std::size_t level = height; level; --level) {
+			const inner* branch = static_cast<const inner*>(at);
+			at = branch->children[search::count_less(branch->keys, branch->count, item)];
+		}
+		const leaf* bottom = static_cast<const leaf*>(at);
+		const unsigned pos = search::count_less(bottom->keys, bottom->count, item);
+		// Every key in the following leaves is at least [item], so past the end of this leaf is the next one's start
+		return pos < bottom->count ? const_iterator(bottom, pos) : const_iterator(bottom->next, 0);
+	}
+
+	~bplus_tree() {
+		if (root)
+			clear(root, height);
+	}
+// Internal methods
+private:
+	// Inserts into the subtree at [at], which sits [level] levels above the leaves
+	// Returns true when [at] split, with the new right node and the key separating it from [at] written out.
+	// Takes O(level) time.
+	template <typename... V>
+	bool insert_into(node* at, const std::size_t level, const Key& item, Key& separator, node*& right, V&&... value) {
+		if (!level) {
+			leaf* bottom = static_cast<leaf*>(at);
+			// Equal keys go after the ones already there
+			const unsigned pos = search::count_not_greater(bottom->keys, bottom->count, item);
+			if (bottom->count < leaf_capacity) {
+				insert_slot(bottom, pos, item, std::forward<V>(value)...);
+				return false;
+			}
+
+			// Full, so move the upper half to a new leaf linked after this one
+			// Appending past the last leaf keeps this one full, so ascending inserts pack the leaves.
+			leaf* split = new leaf();
+			const unsigned keep = (pos == leaf_capacity && !bottom->next) ? leaf_capacity : leaf_capacity / 2;
+			move_slots(bottom, keep, leaf_capacity, split, 0);
+			split->count = leaf_capacity - keep;
+			bottom->count = keep;
+			split->next = bottom->next;
+			bottom->next = split;
+			if (pos <= keep && keep < leaf_capacity)
+				insert_slot(bottom, pos, item, std::forward<V>(value)...);
+			else
+				insert_slot(split, pos - keep, item, std::forward<V>(value)...);
+			separator = split->keys[0];
+			right = split;
+			return true;
+		}
+
+		inner* branch = static_cast<inner*>(at);
+		const unsigned i = search::count_not_greater(branch->keys, branch->count, item);
+		Key child_separator;
+		node* child_right;
+		if (!insert_into(branch->children[i], level - 1, item, child_separator, child_right, std::forward<V>(value)...))
+			return false;
+
+		if (branch->count < inner_capacity) {
+			std::move_backward(branch->keys + i, branch->keys + branch->count, branch->keys + branch->count + 1);
+			std::copy_backward(branch->children + i + 1, branch->children + branch->count + 1, branch->children + branch->count + 2);
+			branch->keys[i] = std::move(child_separator);
+			branch->children[i + 1] = child_right;
+			++branch->count;
+			return false;
+		}
+
+		// Full, so lay out every key and child with the new ones in place, then split around the middle key,
+		// which moves up to the parent
+		Key keys[inner_capacity + 1];
+		node* children[inner_capacity + 2];
+		std::move(branch->keys, branch->keys + i, keys);
+		keys[i] = std::move(child_separator);
+		std::move(branch->keys + i, branch->keys + inner_capacity, keys + i + 1);
+		std::copy(branch->children, branch->children + i + 1, children);
+		children[i + 1] = child_right;
+		std::copy(branch->children + i + 1, branch->children + inner_capacity + 1, children + i + 2);
+
+		const unsigned mid = (inner_capacity + 1) / 2;
+		inner* split = new inner();
+		std::move(keys, keys + mid, branch->keys);
+		std::copy(children, children + mid + 1, branch->children);
+		branch->count = mid;
+		std::move(keys + mid + 1, keys + inner_capacity + 1, split->keys);
+		std::copy(children + mid + 1, children + inner_capacity + 2, split->children);
+		split->count = inner_capacity - mid;
+		separator = std::move(keys[mid]);
+		right = split;
+		return true;
+	}
+
+	// Removes one instance of [item] from the subtree at [at], which sits [level] levels above the leaves
+	// Returns whether it was found. Children left under half full are fixed on the way back up.
+	// Takes O(level) time, more only when equal keys straddle several leaves.
+	bool remove_from(node* at, const std::size_t level, const Key& item) {
+		if (!level) {
+			leaf* bottom = static_cast<leaf*>(at);
+			const unsigned pos = search::count_less(bottom->keys, bottom->count, item);
+			if (pos == bottom->count || item < bottom->keys[pos])
+				return false;
+			move_slots(bottom, pos + 1, bottom->count, bottom, pos);
+			--bottom->count;
+			return true;
+		}
+
+		inner* branch = static_cast<inner*>(at);
+		for (unsigned i = search::count_less(branch->keys, branch->count, item);; ++i) {
+			if (remove_from(branch->children[i], level - 1, item)) {
+				fix_underflow(branch, i, level - 1);
+				return true;
+			}
+			// Equal keys can carry on into the next child, but nothing past a greater separator can match
+			if (i == branch->count || item < branch->keys[i])
+				return false;
+		}
+	}
+
+	// Refills child [i] of [parent] if it has dropped under half full, from a sibling that can spare a key,
+	// otherwise merges it with a sibling, which takes a key from [parent]
+	// Takes O(node size) time.
+	void fix_underflow(inner* parent, const unsigned i, const std::size_t child_level) {
+		if (!child_level) {
+			constexpr unsigned least = leaf_capacity / 2;
+			leaf* child = static_cast<leaf*>(parent->children[i]);
+			if (child->count >= least)
+				return;
+			leaf* left = i > 0 ? static_cast<leaf*>(parent->children[i - 1]) : nullptr;
+			leaf* right = i < parent->count ? static_cast<leaf*>(parent->children[i + 1]) : nullptr;
+			if (left && left->count > least) {
+				move_slots_backward(child, 0, child->count, child, 1);
+				move_slots(left, left->count - 1, left->count, child, 0);
+				--left->count;
+				++child->count;
+				parent->keys[i - 1] = child->keys[0];
+			}
+			else if (right && right->count > least) {
+				move_slots(right, 0, 1, child, child->count);
+				move_slots(right, 1, right->count, right, 0);
+				--right->count;
+				++child->count;
+				parent->keys[i] = right->keys[0];
+			}
+			else {
+				// Merge the right one of the pair into the left one
+				const unsigned j = left ? i - 1 : i;
+				leaf* into = static_cast<leaf*>(parent->children[j]);
+				leaf* from = static_cast<leaf*>(parent->children[j + 1]);
+				move_slots(from, 0, from->count, into, into->count);
+				into->count += from->count;
+				into->next = from->next;
+				delete from;
+				erase_child(parent, j);
+			}
+			return;
+		}
+
+		constexpr unsigned least = inner_capacity / 2;
+		inner* child = static_cast<inner*>(parent->children[i]);
+		if (child->count >= least)
+			return;
+		inner* left = i > 0 ? static_cast<inner*>(parent->children[i - 1]) : nullptr;
+		inner* right = i < parent->count ? static_cast<inner*>(parent->children[i + 1]) : nullptr;
+		if (left && left->count > least) {
+			// The separator comes down into the child and the left sibling's last key goes up in its place
+			std::move_backward(child->keys, child->keys + child->count, child->keys + child->count + 1);
+			std::copy_backward(child->children, child->children + child->count + 1, child->children + child->count + 2);
+			child->keys[0] = std::move(parent->keys[i - 1]);
+			child->children[0] = left->children[left->count];
+			parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+			--left->count;
+			++child->count;
+		}
+		else if (right && right->count > least) {
+			child->keys[child->count] = std::move(parent->keys[i]);
+			child->children[child->count + 1] = right->children[0];
+			parent->keys[i] = std::move(right->keys[0]);
+			std::move(right->keys + 1, right->keys + right->count, right->keys);
+			std::copy(right->children + 1, right->children + right->count + 1, right->children);
+			--right->count;
+			++child->count;
+		}
+		else {
+			// Merge the right one of the pair into the left one, with the separator between them
+			const unsigned j = left ? i - 1 : i;
+			inner* into = static_cast<inner*>(parent->children[j]);
+			inner* from = static_cast<inner*>(parent->children[j + 1]);
+			into->keys[into->count] = std::move(parent->keys[j]);
+			std::move(from->keys, from->keys + from->count, into->keys + into->count + 1);
+			std::copy(from->children, from->children + from->count + 1, into->children + into->count + 1);
+			into->count += from->count + 1;
+			delete from;
+			erase_child(parent, j);
+		}
+	}
+
+	// Removes key [j] and child [j + 1] from [parent]
+	// Takes O(node size) time.
+	static void erase_child(inner* parent, const unsigned j) {
+		std::move(parent->keys + j + 1, parent->keys + parent->count, parent->keys + j);
+		std::copy(parent->children + j + 2, parent->children + parent->count + 1, parent->children + j + 1);
+		--parent->count;
+	}
+
+	// Inserts a key, and its value for a map, at [pos] of a leaf with room for it
+	// Takes O(leaf size) time.
+	template <typename... V>
+	static void insert_slot(leaf* at, const unsigned pos, const Key& item, V&&... value) {
+		move_slots_backward(at, pos, at->count, at, pos + 1);
+		at->keys[pos] = item;
+		if constexpr (is_map)
+			((at->values[pos] = std::forward<V>(value)), ...);
+		++at->count;
+	}
+
+	// Moves the keys, and values for a map, in [begin, end) of [from] to start at [dest] in [to]
+	// Safe when the ranges overlap with [dest] before [begin].
+	static void move_slots(leaf* from, const unsigned begin, const unsigned end, leaf* to, const unsigned dest) {
+		std::move(from->keys + begin, from->keys + end, to->keys + dest);
+		if constexpr (is_map)
+			std::move(from->values + begin, from->values + end, to->values + dest);
+	}
+
+	// Same as move_slots, but safe when the ranges overlap with [dest] after [begin]
+	static void move_slots_backward(leaf* from, const unsigned begin, const unsigned end, leaf* to, const unsigned dest) {
+		std::move_backward(from->keys + begin, from->keys + end, to->keys + dest + (end - begin));
+		if constexpr (is_map)
+			std::move_backward(from->values + begin, from->values + end, to->values + dest + (end - begin));
+	}
+
+	// Remove all nodes from the subtree at [at], which sits [level] levels above the leaves
+	// Takes O(n) time.
+	static void clear(node* at, const std::size_t level) {
+		if (!level) {
+			delete static_cast<leaf*>(at);
+			return;
+		}
+		inner* branch = static_cast<inner*>(at);
+		for (unsigned i = 0; i <= branch->count; ++i)
+			clear(branch->children[i], level - 1);
+		delete branch;
+	}
+// Private fields
+private:
+	node* root = nullptr;
+
+	// Leftmost leaf, where in-order scans start
+	leaf* first = nullptr;
+
+	// Levels of inner nodes above the leaves
+	std::size_t height = 0;
+
+	std::size_t count = 0;
+};
@@ -2,30 +2,138 @@
 #include <vector>
 #include <cstdlib>
 #include <functional>
-template <typename T>
-struct bst_node {
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include "container_stats.h"
+#include "memory_resource.h"
+#include "frozen_search_tree.h"
+#include "serialization.h"
+// Number of nodes in the subtree of a bst_node, only held by trees that track order statistics
+template <bool Sized>
+struct bst_node_size {};
+template <>
+struct bst_node_size<true> {
+	std::size_t size = 1;
+};
+
+template <typename T, bool Sized = false>
+struct bst_node : bst_node_size<Sized> {
 	bst_node(T item) {
 		value = item;
 	}
 	// Child nodes
-	bst_node<T> *left = nullptr, *right = nullptr, *parent = nullptr;
+	bst_node *left = nullptr, *right = nullptr, *parent = nullptr;
 
 	// Value held by node
 	T value;
 };
-template <typename T>
+template <typename T, typename Stats = pz::no_stats, bool OrderStatistics = false>
 // Binary search tree. Only works with comparable types
-struct bst {
+// Nodes come from a std::pmr::memory_resource, the default resource unless one is given.
+// [Stats] is the statistics policy, see container_stats.h.
+// With [OrderStatistics] every node also counts the nodes below it, which adds rank, select and count_range.
+struct bst : protected Stats {
+	using node_type = bst_node<T, OrderStatistics>;
+
+	// In-order iterator, walking between nodes through their child and parent links
+	// Values can't be changed through it, as that could break the ordering.
+	struct const_iterator {
+		const_iterator(node_type* pointer, node_type* const* tree_root) : ptr(pointer), root(tree_root) {};
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using pointer = const T*;
+		using reference = const T&;
+		using difference_type = std::ptrdiff_t;
+
+		// Takes O(1) amortized time.
+		const_iterator& operator++ () {
+			if (ptr->right) {
+				// The next value is the lowest of the right hand side
+				ptr = ptr->right;
+				while (ptr->left)
+					ptr = ptr->left;
+			}
+			else {
+				// Otherwise it is the first ancestor this node is on the left hand side of
+				node_type* child = ptr;
+				ptr = ptr->parent;
+				while (ptr && ptr->right == child) {
+					child = ptr;
+					ptr = ptr->parent;
+				}
+			}
+			return *this;
+		}
+		const_iterator operator++ (int) {
+			const_iterator temp = *this;
+			++*this;
+			return temp;
+		}
+		// Takes O(1) amortized time, O(log n) from the end.
+		const_iterator& operator-- () {
+			if (!ptr) {
+				// Stepping back from the end gives the highest value
+				ptr = *root;
+				while (ptr->right)
+					ptr = ptr->right;
+			}
+			else if (ptr->left) {
+				ptr = ptr->left;
+				while (ptr->right)
+					ptr = ptr->right;
+			}
+			else {
+				node_type* child = ptr;
+				ptr = ptr->parent;
+				while (ptr && ptr->left == child) {
+					child = ptr;
+					ptr = ptr->parent;
+				}
+			}
+			return *this;
+		}
+		const_iterator operator-- (int) {
+			const_iterator temp = *this;
+			--*this;
+			return temp;
+		}
+		bool operator == (const const_iterator& other) const { return ptr == other.ptr; }
+		bool operator != (const const_iterator& other) const { return ptr != other.ptr; }
+		reference operator*() const { return ptr->value; }
+		pointer operator->() const { return &(ptr->value); }
+	protected:
+		node_type* ptr;
+		node_type* const* root;
+	};
+	using iterator = const_iterator;
+
+	// Pair of iterators over part of the tree, usable in a range-based for loop
+	struct range_view {
+		const_iterator first, last;
+		const_iterator begin() const { return first; }
+		const_iterator end() const { return last; }
+	};
+
 	bst(T item) {
-		root = new bst_node<T>(item);
-		count = 1;
+		root = pz::make_node<node_type>(memory, item);
+		Stats::on_allocate(sizeof(node_type));
+		Stats::on_depth(1);
+		count = max_count = 1;
 	}
 	bst() { root = nullptr; }
+
+	// Creates an empty tree that allocates its nodes from [resource]
+	explicit bst(std::pmr::memory_resource* resource) : memory(resource) { root = nullptr; }
 	
 	// Prevent the tree from being copied
 	// Takes O(0) time because the function doesn't even exist during runtime
-	bst(const bst<T>& other) = delete;
-	void operator=(const bst<T>& other) = delete;
+	bst(const bst& other) = delete;
+	void operator=(const bst& other) = delete;
 
 	/// Returns whether the structure is empty
 	// Takes O(1) time.
@@ -33,24 +141,37 @@ struct bst {
 
 	// Append a value to the binary search tree
 	void add(const T item) {
-		bst_node<T> **iter = &root, *prev = nullptr;
+		node_type **iter = &root, *prev = nullptr;
+		std::size_t depth = 0;
 
 		// Traverse until reaching an empty space, and insert the value in that empty space
-		while (bst_node<T> *temp =  *iter) {
+		while (node_type *temp =  *iter) {
 			// Parent node
 			prev = *iter;
+			++depth;
+			// The new node will be below every node on the way down
+			if constexpr (OrderStatistics)
+				++temp->size;
 
 			// Go left if lesser, else go right
 			iter = (item < temp->value) ? &temp->left : &temp->right;
 		}
-		*iter = new bst_node<T>(item);
-		(*iter)->parent = prev;
+		node_type* added = *iter = pz::make_node<node_type>(memory, item);
+		added->parent = prev;
 		++count;
+		max_count = std::max(max_count, count);
+		Stats::on_allocate(sizeof(node_type));
+		Stats::on_traverse(depth);
+		Stats::on_depth(depth + 1);
+
+		// Too deep for the alpha bound, so rebuild the lowest ancestor whose children are out of balance
+		if (alpha && depth > height_bound())
+			rebuild_scapegoat(added);
 	}
 
 	// Find value and return pointer to it
 	const T* find(const T item) {
-		bst_node<T> temp = *find_node_of(item);
+		node_type* temp = *find_node_of(item);
 		// Return the address of the value or return nullptr
 		return (temp) ? &(temp->value): nullptr;
 	}
@@ -58,22 +179,49 @@ struct bst {
 	// Remove a single instance of a value from the binary search tree
 	void remove(const T item) {
 		// Find node of the value
-		bst_node<T>** ptr = find_node_of(item, root);
+		node_type** ptr = find_node_of(item);
 		// If it wasn't found do nothing
-		if (bst_node<T>* selected = *ptr) {
-			// Traverse down to the lowest value of right hand side of value node
-			bst_node<T> **low_right = find_min_from(selected->right);
-
-			// The furthest down on the right tree now links to the left of the original
-			*low_right = selected->left;
+		if (node_type* selected = *ptr) {
+			// With two children, take the lowest value of the right hand side and remove its node instead
+			if (selected->left && selected->right) {
+				node_type* low_right = find_min_from(selected->right);
+				selected->value = low_right->value;
+				ptr = (low_right->parent == selected) ? &selected->right : &low_right->parent->left;
+				selected = low_right;
+			}
 
-			// The node is replace by its right
-			*ptr = selected->right;
-			delete selected;
+			// The node has at most one child now, which takes its place
+			node_type* child = selected->left ? selected->left : selected->right;
+			if (child)
+				child->parent = selected->parent;
+			*ptr = child;
+			if constexpr (OrderStatistics)
+				for (node_type* above = selected->parent; above; above = above->parent)
+					--above->size;
+			pz::destroy_node(memory, selected);
 
 			--count;
-		};
-		
+
+			// Enough removals can leave the tree deeper than the bound allows, so rebuild it all
+			if (alpha && count < alpha * max_count)
+				rebalance();
+		}
+	}
+
+	// Keeps the tree balanced from now on, with no subtree holding more than [balance] of its parent's nodes
+	// [balance] is between 0.5 and 1, lower keeps the tree shallower at the cost of more frequent rebuilds.
+	// Inserts that go deeper than log(n) / log(1 / balance) rebuild only the offending subtree,
+	// so adds and removes take O(log n) amortized time with no rebuilds of the whole tree on insert.
+	// A [balance] of 0 turns self-balancing off.
+	// Takes O(n) time, as the tree is rebalanced first.
+	void self_balance(const double balance) {
+		if (balance && (balance <= 0.5 || balance >= 1))
+			throw std::invalid_argument("Balance must be between 0.5 and 1");
+		alpha = balance;
+		if (alpha) {
+			log_inverse_alpha = std::log(1 / alpha);
+			rebalance();
+		}
 	}
 	/// Number of elements in binary search tree.
 	// Takes O(1) time.
@@ -85,81 +233,296 @@ struct bst {
 	// Takes O(n) time.
 	std::vector<T> to_vector() {
 		std::vector<T> arr;
-		std::function<void(bst_node<T>*)> collect = [&collect, &arr]
-		(bst_node<T>* node) {
-			if (node) {
-				collect(node -> left);
-				arr.push_back(node -> value);
-				collect(node -> right);
-			}
-		}; collect(root);
+		arr.reserve(count);
+		for (const auto& value : *this)
+			arr.push_back(value);
 		return arr;
 	}
+
+	// Returns an iterator at the lowest value
+	// Takes O(log n) time.
+	const_iterator begin() const {
+		return const_iterator(root ? find_min_from(root) : nullptr, &root);
+	}
+
+	// Returns an iterator past the highest value
+	const_iterator end() const { return const_iterator(nullptr, &root); }
+
+	// Returns an iterator at the first value not less than [item]
+	// Takes O(log n) time.
+	const_iterator lower_bound(const T& item) const {
+		node_type* found = nullptr;
+		for (node_type* node = root; node;) {
+			// Equal values can end up on either side after a rebalance, so keep going left past them
+			if (node->value < item)
+				node = node->right;
+			else {
+				found = node;
+				node = node->left;
+			}
+		}
+		return const_iterator(found, &root);
+	}
+
+	// Returns an iterator at the first value greater than [item]
+	// Takes O(log n) time.
+	const_iterator upper_bound(const T& item) const {
+		node_type* found = nullptr;
+		for (node_type* node = root; node;) {
+			if (item < node->value) {
+				found = node;
+				node = node->left;
+			}
+			else
+				node = node->right;
+		}
+		return const_iterator(found, &root);
+	}
+
+	// Returns the values from [low] inclusive to [high] exclusive, in order
+	// Only the nodes in the range are visited.
+	// Takes O(log n + k) time for k values.
+	range_view range(const T& low, const T& high) const {
+		if (!(low < high))
+			return { end(), end() };
+		return { lower_bound(low), lower_bound(high) };
+	}
+
+	// Number of values less than [item], i.e. the index lower_bound(item) would have
+	// Takes O(log n) time. Requires OrderStatistics.
+	std::size_t rank(const T& item) const {
+		static_assert(OrderStatistics, "rank needs a bst with OrderStatistics");
+		std::size_t less = 0;
+		for (node_type* node = root; node;) {
+			if (node->value < item) {
+				// This node and everything on its left are less
+				less += 1 + subtree_size(node->left);
+				node = node->right;
+			}
+			else
+				node = node->left;
+		}
+		return less;
+	}
+
+	// Returns an iterator at the value with index [k] in value order, or end() if there are fewer values
+	// Takes O(log n) time. Requires OrderStatistics.
+	const_iterator select(std::size_t k) const {
+		static_assert(OrderStatistics, "select needs a bst with OrderStatistics");
+		node_type* node = (k < count) ? root : nullptr;
+		while (node) {
+			const std::size_t left = subtree_size(node->left);
+			if (k < left)
+				node = node->left;
+			else if (k == left)
+				break;
+			else {
+				k -= left + 1;
+				node = node->right;
+			}
+		}
+		return const_iterator(node, &root);
+	}
+
+	// Number of values from [low] inclusive to [high] exclusive
+	// Takes O(log n) time. Requires OrderStatistics.
+	std::size_t count_range(const T& low, const T& high) const {
+		return (low < high) ? rank(high) - rank(low) : 0;
+	}
+
+	// Replaces the contents of the tree with the values of a sorted range, building it balanced
+	// Takes O(n) time.
+	template <typename Iter>
+	void bulk_load(Iter first, Iter last) {
+		clear(root);
+		root = nullptr;
+		std::vector<node_type*> ordered;
+		for (; first != last; ++first) {
+			ordered.push_back(pz::make_node<node_type>(memory, *first));
+			Stats::on_allocate(sizeof(node_type));
+		}
+		count = max_count = ordered.size();
+		root = link_balanced(ordered);
+		if (root)
+			root->parent = nullptr;
+	}
 	
+	// Writes the tree's values in order in the binary format from serialization.h
+	// Takes O(n) time.
+	void serialize(pz::byte_sink& sink) const {
+		pz::write_serial_header<T>(sink, count);
+		for (const T& value : *this)
+			pz::serial_traits<T>::write(sink, value);
+	}
+
+	// Replaces the contents of the tree with sorted values written by serialize() or any other pz container, building it balanced
+	// Trees can't be moved, so unlike the array containers this fills an existing tree rather than returning one.
+	// Throws std::runtime_error if the values aren't in order.
+	// Takes O(n) time.
+	void deserialize(pz::byte_source& source) {
+		const std::size_t size = pz::read_serial_header<T>(source);
+		std::vector<T> values;
+		if constexpr (pz::serial_traits<T>::bulk) {
+			values.resize(size);
+			source.read(values.data(), size * sizeof(T));
+		}
+		else {
+			values.reserve(size);
+			for (std::size_t i = 0; i < size; ++i)
+				values.push_back(pz::serial_traits<T>::read(source));
+		}
+		if (!std::is_sorted(values.begin(), values.end()))
+			throw std::runtime_error("Serialized values aren't in order");
+		bulk_load(values.begin(), values.end());
+	}
+
+	// Writes the tree's values in order as text in the form [a, b, c]
+	// Takes O(n) time.
+	void write_text(pz::byte_sink& sink) const { pz::write_text_list(sink, begin(), end()); }
+
+	// Returns a read-only copy of the tree laid out in one array for fast lookups
+	// The copy does not change when this tree does.
+	// Takes O(n) time.
+	frozen_bst<T> freeze() {
+		return frozen_bst<T>(to_vector());
+	}
+
+	// Returns what the statistics policy has recorded.
+	// Takes O(1) time.
+	pz::container_stats stats() const noexcept { return Stats::snapshot(); }
+
+	// Returns the memory resource the tree allocates from.
+	// Takes O(1) time.
+	std::pmr::memory_resource* resource() const noexcept { return memory; }
+
 	// Rebalances the tree for faster traversal
+	// The nodes are relinked in place rather than reallocated.
+	// Takes O(n) time.
 	void rebalance() {
-		auto size = count;
-		T *ordered = new T[size];
-		std::size_t num = 0;
-
-		// Removes all elements and adds them to an array in value order
-		std::function<void(bst_node<T>*)> pop = [&num, &pop, ordered]
-		(bst_node<T>* node) {
-			if (node) {
-				pop(node->left);
-				*(ordered + num++) = node->value;
-				pop(node->right);
-				delete node;
+		root = rebuild(root, count);
+		if (root)
+			root->parent = nullptr;
+		max_count = count;
+
+		// A perfectly balanced tree of n nodes has a height of floor(log2(n)) + 1
+		std::size_t height = 0;
+		for (auto n = count; n; n >>= 1)
+			++height;
+		Stats::on_rebalance(height);
+	}
+	~bst() {
+		clear(root);
+	}
+// Internal methods
+private:
+	// Relinks the [size] nodes of the subtree at [local_root] into a perfectly balanced subtree and returns its root
+	// The parent of the returned root is left for the caller to set.
+	// Takes O(size) time.
+	node_type* rebuild(node_type* local_root, const std::size_t size) {
+		// Collect the nodes in value order, iteratively so degenerate trees can't overflow the stack
+		std::vector<node_type*> ordered;
+		ordered.reserve(size);
+		std::vector<node_type*> path;
+		for (node_type* node = local_root; node || !path.empty();) {
+			while (node) {
+				path.push_back(node);
+				node = node->left;
 			}
-		}; pop(root);
+			node = path.back();
+			path.pop_back();
+			ordered.push_back(node);
+			node = node->right;
+		}
+		return link_balanced(ordered);
+	}
 
-		// Add the values into the new tree
-		std::function<bst_node<T>* (std::size_t, std::size_t)> arr_to_bst = [ordered, &arr_to_bst]
-		(std::size_t left, std::size_t right) {
+	// Links nodes given in value order into a perfectly balanced subtree and returns its root
+	// The parent of the returned root is left for the caller to set.
+	// Takes O(n) time.
+	node_type* link_balanced(const std::vector<node_type*>& ordered) {
+		// Link the middle node of each section to the middles of its halves
+		std::function<node_type* (std::size_t, std::size_t)> arr_to_bst = [&ordered, &arr_to_bst]
+		(std::size_t left, std::size_t right) -> node_type* {
 			const auto size = right - left;
+			// Empty sections have no node
+			if (!size)
+				return nullptr;
 
 			// Middle index for section
 			const auto mid = left + size / 2;
-			
-			// Create a node for value
-			bst_node<T>* point = new bst_node<T>(ordered[mid]);
-
-			// No splitting of single nodes
-			if (size > 1) {
-				point->left = arr_to_bst(left, mid);
-				point->right = arr_to_bst(mid + 1, right);
-			}
+			node_type* point = ordered[mid];
+
+			if ((point->left = arr_to_bst(left, mid)))
+				point->left->parent = point;
+			if ((point->right = arr_to_bst(mid + 1, right)))
+				point->right->parent = point;
+			if constexpr (OrderStatistics)
+				point->size = size;
 
 			return point;
 		};
-		root = arr_to_bst(0, count);
+		return arr_to_bst(0, ordered.size());
+	}
 
+	// Deepest an insert may go under the alpha bound, log(n) / log(1 / alpha)
+	// Takes O(1) time.
+	std::size_t height_bound() const {
+		return static_cast<std::size_t>(std::log(static_cast<double>(count)) / log_inverse_alpha);
 	}
-	~bst() {
-		clear(root);
+
+	// Walks up from a node that was inserted too deep, rebuilding the first ancestor
+	// with a child holding more than alpha of its nodes. Such an ancestor always exists on the path.
+	// Takes O(size of the rebuilt subtree) time.
+	void rebuild_scapegoat(node_type* added) {
+		node_type* child = added;
+		std::size_t child_size = 1;
+		for (node_type* node = added->parent; node; child = node, node = node->parent) {
+			const std::size_t size = child_size + 1 + subtree_size(node->left == child ? node->right : node->left);
+			if (child_size > alpha * size) {
+				node_type* parent = node->parent;
+				node_type** slot = !parent ? &root : (parent->left == node) ? &parent->left : &parent->right;
+				*slot = rebuild(node, size);
+				(*slot)->parent = parent;
+				Stats::on_rebalance(0);
+				return;
+			}
+			child_size = size;
+		}
 	}
-// Internal methods
-private:
+
+	// Number of nodes in the subtree at [node]
+	// Counted on demand, only on subtrees kept within the alpha bound so the recursion stays shallow.
+	// Takes O(1) time with order statistics, otherwise O(size).
+	static std::size_t subtree_size(node_type* node) {
+		if constexpr (OrderStatistics)
+			return node ? node->size : 0;
+		else
+			return node ? 1 + subtree_size(node->left) + subtree_size(node->right) : 0;
+	}
+
 	// Find the node that holds that value and return a pointer to it
-	bst_node<T>** find_node_of(const T item, bst_node<T>* local_root) {
-		bst_node<T> **iter = &local_root;
-		bst_node<T>* current = *iter;
+	node_type** find_node_of(const T item) {
+		node_type **iter = &root;
+		node_type* current = *iter;
+		std::size_t steps = 0;
 		// Run until nullptr or value
 		while (current && (current->value != item)) {
 			// If the item's value is less than the pivot's, go left, if it is more than or equal, go right
 			iter = (item < current->value) ? &(current->left) : &(current->right);
 			current = *iter;
+			++steps;
 		}
+		Stats::on_traverse(steps);
 		return iter;
 	}
 	// Continually traverses left from that starting point, returning the last non-null node
-	bst_node<T>** find_min_from(bst_node<T>* ptr) {
-		while (&ptr->left)
+	static node_type* find_min_from(node_type* ptr) {
+		while (ptr -> left)
 			ptr = ptr -> left;
-		return &ptr;
+		return ptr;
 	}
 	// Continually traverses right from that starting point, returning the last non-null node
-	bst_node<T>* find_max_from(bst_node<T>* ptr) {
+	node_type* find_max_from(node_type* ptr) {
 		while (ptr -> right)
 			ptr = ptr -> right;
 		return ptr;
@@ -167,17 +530,274 @@ private:
 
 	// Remove all nodes from the tree.
 	// Takes O(n) time.
-	void clear(bst_node<T>* node) {
+	void clear(node_type* node) {
 		if (node) {
 			clear(node->left);
 			clear(node->right);
-			delete node;
+			pz::destroy_node(memory, node);
 		}
 		count = 0;
 	}
 // Private fields
 private:
+	std::pmr::memory_resource* memory = std::pmr::get_default_resource();
+
 	std::size_t count = 0;
+
+	// Most nodes held since the last full rebalance
+	std::size_t max_count = 0;
+
+	// Self-balancing bound, 0 when self-balancing is off
+	double alpha = 0;
+	double log_inverse_alpha = 0;
+protected:
+	node_type* root;
+};
+
+// Index of no node in an arena_bst
+constexpr std::uint32_t arena_null = UINT32_MAX;
+
+// Node of an arena_bst, linked by 32-bit indices into the arena rather than pointers
+// There is no parent link, walks keep the index slot they came through instead.
+template <typename T>
+struct arena_bst_node {
+	// Value held by node
+	T value;
+
+	// Child nodes
+	std::uint32_t left = arena_null, right = arena_null;
+};
+
+template <typename T, typename Stats = pz::no_stats>
+// Binary search tree with its nodes kept in contiguous slabs and linked by 32-bit indices
+// Nodes are taken from a free list or the end of the last slab, so there is no allocation per insert,
+// and slabs never move, so pointers to values stay valid until their node is removed.
+// Only works with comparable types
+// Slabs come from a std::pmr::memory_resource, the default resource unless one is given.
+// [Stats] is the statistics policy, see container_stats.h.
+struct arena_bst : protected Stats {
+	using node = arena_bst_node<T>;
+
+	// Number of nodes in each slab, a power of two so an index splits into slab and slot with a shift and mask
+	static constexpr std::uint32_t slab_bits = 12;
+	static constexpr std::uint32_t slab_size = std::uint32_t(1) << slab_bits;
+
+	arena_bst() = default;
+
+	// Creates an empty tree that allocates its slabs from [resource]
+	explicit arena_bst(std::pmr::memory_resource* resource) : memory(resource) {}
+
+	// Prevent the tree from being copied
+	arena_bst(const arena_bst& other) = delete;
+	void operator=(const arena_bst& other) = delete;
+
+	/// Returns whether the structure is empty
+	// Takes O(1) time.
+	bool empty() const noexcept { return root == arena_null; }
+
+	/// Number of elements in binary search tree.
+	// Takes O(1) time.
+	std::size_t size() const noexcept { return count; }
+
+	// Append a value to the binary search tree
+	void add(const T item) {
+		std::uint32_t* iter = &root;
+		std::size_t depth = 0;
+
+		// Traverse until reaching an empty space, and insert the value in that empty space
+		while (*iter != arena_null) {
+			node& temp = at(*iter);
+			++depth;
+
+			// Go left if lesser, else go right
+			iter = (item < temp.value) ? &temp.left : &temp.right;
+		}
+		// Slabs never move, so the slot is still valid after allocating
+		*iter = allocate(item);
+		++count;
+		Stats::on_traverse(depth);
+		Stats::on_depth(depth + 1);
+	}
+
+	// Find value and return pointer to it
+	const T* find(const T item) {
+		const std::uint32_t index = *find_slot_of(item);
+		// Return the address of the value or return nullptr
+		return (index != arena_null) ? &at(index).value : nullptr;
+	}
+
+	// Remove a single instance of a value from the binary search tree
+	void remove(const T item) {
+		std::uint32_t* slot = find_slot_of(item);
+		// If it wasn't found do nothing
+		if (*slot == arena_null)
+			return;
+		node& selected = at(*slot);
+
+		// With two children, take the lowest value of the right hand side and remove its node instead
+		if (selected.left != arena_null && selected.right != arena_null) {
+			std::uint32_t* low_right = &selected.right;
+			while (at(*low_right).left != arena_null)
+				low_right = &at(*low_right).left;
+			selected.value = std::move(at(*low_right).value);
+			slot = low_right;
+		}
+
+		// The node has at most one child now, which takes its place
+		const std::uint32_t removed = *slot;
+		const node& unlinked = at(removed);
+		*slot = (unlinked.left != arena_null) ? unlinked.left : unlinked.right;
+		deallocate(removed);
+		--count;
+	}
+
+	// Finds all values in the tree and outputs them to a an ordered vector
+	// Takes O(n) time.
+	std::vector<T> to_vector() {
+		std::vector<T> arr;
+		arr.reserve(count);
+		for_each_index([this, &arr](const std::uint32_t index) { arr.push_back(at(index).value); });
+		return arr;
+	}
+
+	// Returns a read-only copy of the tree laid out in one array for fast lookups
+	// Takes O(n) time.
+	frozen_bst<T> freeze() {
+		return frozen_bst<T>(to_vector());
+	}
+
+	// Rebalances the tree for faster traversal
+	// Only the index links are rewritten, the values stay where they are.
+	// Takes O(n) time.
+	void rebalance() {
+		std::vector<std::uint32_t> ordered;
+		ordered.reserve(count);
+		for_each_index([&ordered](const std::uint32_t index) { ordered.push_back(index); });
+
+		// Link the middle of each section to the middles of its halves
+		std::function<std::uint32_t(std::size_t, std::size_t)> arr_to_bst = [this, &ordered, &arr_to_bst]
+		(std::size_t left, std::size_t right) {
+			if (left == right)
+				return arena_null;
+			const auto mid = left + (right - left) / 2;
+			const std::uint32_t index = ordered[mid];
+			at(index).left = arr_to_bst(left, mid);
+			at(index).right = arr_to_bst(mid + 1, right);
+			return index;
+		};
+		root = arr_to_bst(0, ordered.size());
+
+		// A perfectly balanced tree of n nodes has a height of floor(log2(n)) + 1
+		std::size_t height = 0;
+		for (auto n = count; n; n >>= 1)
+			++height;
+		Stats::on_rebalance(height);
+	}
+
+	// Remove all nodes from the tree, keeping the slabs for reuse.
+	// Takes O(1) time for trivially destructible T, otherwise O(n) to destroy the values.
+	void clear() {
+		if (!std::is_trivially_destructible<T>::value)
+			for_each_index([this](const std::uint32_t index) { at(index).~node(); });
+		root = arena_null;
+		free_nodes.clear();
+		used = 0;
+		count = 0;
+	}
+
+	// Returns what the statistics policy has recorded.
+	// Takes O(1) time.
+	pz::container_stats stats() const noexcept { return Stats::snapshot(); }
+
+	// Returns the memory resource the tree allocates slabs from.
+	// Takes O(1) time.
+	std::pmr::memory_resource* resource() const noexcept { return memory; }
+
+	~arena_bst() {
+		clear();
+		for (node* slab : slabs)
+			memory->deallocate(slab, sizeof(node) * slab_size, alignof(node));
+	}
+// Internal methods
+private:
+	// Node at [index]
+	// Takes O(1) time.
+	node& at(const std::uint32_t index) const {
+		return slabs[index >> slab_bits][index & (slab_size - 1)];
+	}
+
+	// Constructs a node from the free list, or from the end of the slabs, adding a slab when they are full
+	std::uint32_t allocate(const T& item) {
+		std::uint32_t index;
+		if (!free_nodes.empty()) {
+			index = free_nodes.back();
+			free_nodes.pop_back();
+		}
+		else {
+			if (used == arena_null)
+				throw std::length_error("arena_bst is full");
+			if ((used >> slab_bits) == slabs.size()) {
+				slabs.push_back(static_cast<node*>(memory->allocate(sizeof(node) * slab_size, alignof(node))));
+				Stats::on_allocate(sizeof(node) * slab_size);
+			}
+			index = used++;
+		}
+		new (&at(index)) node{ item };
+		return index;
+	}
+
+	// Destroys a node and puts it on the free list
+	void deallocate(const std::uint32_t index) {
+		at(index).~node();
+		free_nodes.push_back(index);
+	}
+
+	// Find the slot that links to the node holding that value
+	std::uint32_t* find_slot_of(const T& item) {
+		std::uint32_t* iter = &root;
+		std::size_t steps = 0;
+		// Run until no node or value
+		while (*iter != arena_null && at(*iter).value != item) {
+			// If the item's value is less than the pivot's, go left, if it is more than or equal, go right
+			node& current = at(*iter);
+			iter = (item < current.value) ? &current.left : &current.right;
+			++steps;
+		}
+		Stats::on_traverse(steps);
+		return iter;
+	}
+
+	// Calls [visit] with the index of every node in value order, with an explicit stack instead of recursion
+	// Takes O(n) time.
+	template <typename Visit>
+	void for_each_index(Visit visit) {
+		std::vector<std::uint32_t> path;
+		std::uint32_t index = root;
+		while (index != arena_null || !path.empty()) {
+			while (index != arena_null) {
+				path.push_back(index);
+				index = at(index).left;
+			}
+			index = path.back();
+			path.pop_back();
+			// Read the right link before visiting, in case the visit destroys the node
+			const std::uint32_t right = at(index).right;
+			visit(index);
+			index = right;
+		}
+	}
+// Private fields
+private:
+	std::pmr::memory_resource* memory = std::pmr::get_default_resource();
+
+	std::vector<node*> slabs;
+	std::size_t count = 0;
+
+	// Number of nodes ever handed out from the slabs
+	std::uint32_t used = 0;
+
+	// Indices of removed nodes, reused before taking new ones from the slabs
+	std::vector<std::uint32_t> free_nodes;
 protected:
-	bst_node<T>* root;
+	std::uint32_t root = arena_null;
 };
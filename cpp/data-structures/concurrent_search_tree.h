@@ -0,0 +1,282 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template <typename T>
+// Binary search tree that any number of threads can read while one thread at a time writes
+// Nodes are never changed once published. A write copies the nodes on the path it changes,
+// then publishes the new root atomically, so readers see either the whole old tree or the whole new tree
+// without taking any lock. Replaced nodes are freed once no reader can still be walking them,
+// tracked with epochs: readers pin the epoch they started in, and the writer frees nodes
+// retired in an epoch older than every pinned one.
+// Only works with comparable types
+struct concurrent_bst {
+	struct node {
+		// Value held by node
+		const T value;
+
+		// Child nodes
+		const node *const left, *const right;
+	};
+
+	// Number of readers that can hold a read_guard at the same time, more wait for a free slot
+	static constexpr std::size_t reader_slots = 256;
+
+	// Pins the tree as it was when the guard was taken, for lock-free lookups
+	// Nodes seen through the guard stay valid until it is destroyed, so hold it briefly.
+	struct read_guard {
+		read_guard(const concurrent_bst& owner) : tree(owner), slot(owner.pin()), snapshot(owner.root.load()) {}
+		read_guard(const read_guard& other) = delete;
+		void operator=(const read_guard& other) = delete;
+		~read_guard() { tree.slots[slot].epoch.store(0); }
+
+		// Find value and return pointer to it, valid while the guard is held
+		// Takes O(log n) time on a balanced tree.
+		const T* find(const T& item) const {
+			const node* current = snapshot;
+			// If the item's value is less than the pivot's, go left, if it is more than or equal, go right
+			while (current && current->value != item)
+				current = (item < current->value) ? current->left : current->right;
+			return current ? &current->value : nullptr;
+		}
+
+		// Finds all values in the pinned tree and outputs them to an ordered vector
+		// Takes O(n) time.
+		std::vector<T> to_vector() const {
+			std::vector<T> arr;
+			std::vector<const node*> path;
+			for (const node* current = snapshot; current || !path.empty();) {
+				while (current) {
+					path.push_back(current);
+					current = current->left;
+				}
+				current = path.back();
+				path.pop_back();
+				arr.push_back(current->value);
+				current = current->right;
+			}
+			return arr;
+		}
+	private:
+		const concurrent_bst& tree;
+		std::size_t slot;
+		const node* snapshot;
+	};
+
+	concurrent_bst() = default;
+
+	// Prevent the tree from being copied
+	concurrent_bst(const concurrent_bst& other) = delete;
+	void operator=(const concurrent_bst& other) = delete;
+
+	// Pins the current version of the tree for reading
+	// Takes O(1) time while reader slots are free.
+	read_guard read() const { return read_guard(*this); }
+
+	// Returns whether the value is in the tree
+	// Takes O(log n) time on a balanced tree.
+	bool contains(const T& item) const { return read().find(item) != nullptr; }
+
+	/// Number of elements in binary search tree.
+	// Takes O(1) time.
+	std::size_t size() const noexcept { return count.load(); }
+
+	/// Returns whether the structure is empty
+	// Takes O(1) time.
+	bool empty() const noexcept { return !root.load(); }
+
+	// Finds all values in the tree and outputs them to an ordered vector
+	// Takes O(n) time.
+	std::vector<T> to_vector() const { return read().to_vector(); }
+
+	// Append a value to the binary search tree
+	// Copies the nodes from the root down to the new one.
+	// Takes O(log n) time on a balanced tree.
+	void add(const T item) {
+		std::lock_guard<std::mutex> lock(writer);
+		std::vector<const node*> path, retired;
+		std::vector<bool> went_left;
+
+		// Traverse until reaching an empty space
+		for (const node* current = root.load(); current;) {
+			path.push_back(current);
+			went_left.push_back(item < current->value);
+			current = went_left.back() ? current->left : current->right;
+		}
+		publish(copy_path(path, went_left, new node{ item, nullptr, nullptr }, retired), retired);
+		++count;
+	}
+
+	// Remove a single instance of a value from the binary search tree
+	// Copies the nodes from the root down to the removed one, and down to its replacement.
+	// Takes O(log n) time on a balanced tree.
+	void remove(const T item) {
+		std::lock_guard<std::mutex> lock(writer);
+		std::vector<const node*> path, retired;
+		std::vector<bool> went_left;
+
+		const node* selected = root.load();
+		while (selected && selected->value != item) {
+			path.push_back(selected);
+			went_left.push_back(item < selected->value);
+			selected = went_left.back() ? selected->left : selected->right;
+		}
+		// If it wasn't found do nothing
+		if (!selected)
+			return;
+		retired.push_back(selected);
+
+		const node* replacement;
+		if (!selected->left || !selected->right)
+			replacement = selected->left ? selected->left : selected->right;
+		else {
+			// Take the lowest value of the right hand side, copying the path down to it
+			std::vector<const node*> right_path;
+			const node* low_right = selected->right;
+			while (low_right->left) {
+				right_path.push_back(low_right);
+				low_right = low_right->left;
+			}
+			retired.push_back(low_right);
+			const node* right = low_right->right;
+			for (auto it = right_path.rbegin(); it != right_path.rend(); ++it) {
+				retired.push_back(*it);
+				right = new node{ (*it)->value, right, (*it)->right };
+			}
+			replacement = new node{ low_right->value, selected->left, right };
+		}
+		publish(copy_path(path, went_left, replacement, retired), retired);
+		--count;
+	}
+
+	// Rebuilds the tree perfectly balanced and publishes it in one step
+	// Takes O(n) time.
+	void rebalance() {
+		std::lock_guard<std::mutex> lock(writer);
+		const node* old_root = root.load();
+		std::vector<const node*> ordered, path;
+		for (const node* current = old_root; current || !path.empty();) {
+			while (current) {
+				path.push_back(current);
+				current = current->left;
+			}
+			current = path.back();
+			path.pop_back();
+			ordered.push_back(current);
+			current = current->right;
+		}
+
+		// Build new nodes from the middle of each section, every old node is retired
+		std::function<const node* (std::size_t, std::size_t)> arr_to_bst = [&ordered, &arr_to_bst]
+		(std::size_t left, std::size_t right) -> const node* {
+			if (left == right)
+				return nullptr;
+			const auto mid = left + (right - left) / 2;
+			return new node{ ordered[mid]->value, arr_to_bst(left, mid), arr_to_bst(mid + 1, right) };
+		};
+		const node* new_root = arr_to_bst(0, ordered.size());
+		publish(new_root, ordered);
+	}
+
+	~concurrent_bst() {
+		// No readers can be left, so everything is freed
+		for (auto& batch : retired_batches)
+			for (const node* old : batch.nodes)
+				delete old;
+		std::vector<const node*> pending;
+		if (const node* top = root.load())
+			pending.push_back(top);
+		while (!pending.empty()) {
+			const node* current = pending.back();
+			pending.pop_back();
+			if (current->left)
+				pending.push_back(current->left);
+			if (current->right)
+				pending.push_back(current->right);
+			delete current;
+		}
+	}
+// Internal methods
+private:
+	// Nodes replaced by one write, tagged with the epoch they were replaced in
+	struct retired_batch {
+		std::uint64_t epoch;
+		std::vector<const node*> nodes;
+	};
+
+	// Epoch pinned by a reader, 0 when free, one per cache line so readers don't contend
+	struct alignas(64) reader_slot {
+		std::atomic<std::uint64_t> epoch{ 0 };
+	};
+
+	// Copies the nodes on [path] bottom up so they lead to [bottom], retiring the originals
+	// Returns the new root.
+	// Takes O(path length) time.
+	static const node* copy_path(const std::vector<const node*>& path, const std::vector<bool>& went_left,
+		const node* bottom, std::vector<const node*>& retired) {
+		for (std::size_t i = path.size(); i-- > 0;) {
+			const node* original = path[i];
+			retired.push_back(original);
+			bottom = went_left[i] ? new node{ original->value, bottom, original->right }
+				: new node{ original->value, original->left, bottom };
+		}
+		return bottom;
+	}
+
+	// Makes [new_root] visible to readers, then frees whatever earlier writes retired that no reader can still see
+	void publish(const node* new_root, std::vector<const node*>& retired) {
+		root.store(new_root);
+
+		// Readers that pin from now on get a later epoch, and can only reach the new root
+		const std::uint64_t retired_in = epoch.fetch_add(1);
+		retired_batches.push_back({ retired_in, std::move(retired) });
+
+		// The oldest epoch a reader is still pinned in
+		std::uint64_t oldest = UINT64_MAX;
+		for (const auto& slot : slots)
+			if (const std::uint64_t pinned = slot.epoch.load())
+				oldest = std::min(oldest, pinned);
+
+		// Batches retired before the oldest pinned epoch can't be reached by anyone
+		std::size_t freed = 0;
+		while (freed < retired_batches.size() && retired_batches[freed].epoch < oldest) {
+			for (const node* old : retired_batches[freed].nodes)
+				delete old;
+			++freed;
+		}
+		retired_batches.erase(retired_batches.begin(), retired_batches.begin() + freed);
+	}
+
+	// Claims a reader slot and pins the current epoch in it, returning the slot
+	// Each thread starts looking at a different slot so readers rarely collide.
+	// Takes O(1) time while slots are free.
+	std::size_t pin() const {
+		std::size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % reader_slots;
+		while (true) {
+			std::uint64_t expected = 0;
+			if (slots[slot].epoch.compare_exchange_strong(expected, epoch.load()))
+				return slot;
+			if (++slot == reader_slots) {
+				slot = 0;
+				std::this_thread::yield();
+			}
+		}
+	}
+// Private fields
+private:
+	std::atomic<const node*> root{ nullptr };
+	std::atomic<std::size_t> count{ 0 };
+
+	// Epoch 0 marks a free reader slot, so counting starts at 1
+	mutable std::atomic<std::uint64_t> epoch{ 1 };
+	mutable reader_slot slots[reader_slots];
+
+	// Serialises writers, readers never take it
+	std::mutex writer;
+	std::vector<retired_batch> retired_batches;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+
+namespace pz {
+	// Snapshot of the work a container has done since it was created
+	struct container_stats {
+		// Number of heap allocations made
+		std::size_t allocations = 0;
+
+		// Bytes allocated over all allocations
+		std::size_t bytes_allocated = 0;
+
+		// Bytes moved from old storage into new storage when growing
+		std::size_t bytes_moved = 0;
+
+		// Nodes or slots walked by inserts, lookups and removals
+		std::size_t traversal_steps = 0;
+
+		// Longest single walk
+		std::size_t max_traversal = 0;
+
+		// Height of the tree, the deepest insert since the last rebalance
+		std::size_t height = 0;
+
+		// Number of rebalances
+		std::size_t rebalances = 0;
+	};
+
+	// Statistics policy that records nothing
+	// Containers inherit from their policy, so this takes no space and every hook compiles away.
+	struct no_stats {
+		void on_allocate(std::size_t) noexcept {}
+		void on_move(std::size_t) noexcept {}
+		void on_traverse(std::size_t) noexcept {}
+		void on_depth(std::size_t) noexcept {}
+		void on_rebalance(std::size_t) noexcept {}
+		container_stats snapshot() const noexcept { return {}; }
+	};
+
+	// Statistics policy that counts every hook
+	struct counting_stats {
+		void on_allocate(const std::size_t bytes) noexcept {
+			++counters.allocations;
+			counters.bytes_allocated += bytes;
+		}
+		void on_move(const std::size_t bytes) noexcept { counters.bytes_moved += bytes; }
+		void on_traverse(const std::size_t steps) noexcept {
+			counters.traversal_steps += steps;
+			counters.max_traversal = std::max(counters.max_traversal, steps);
+		}
+		void on_depth(const std::size_t depth) noexcept { counters.height = std::max(counters.height, depth); }
+		// The tree or one of its subtrees was rebuilt, a non-zero height is the new height of the whole tree
+		void on_rebalance(const std::size_t height) noexcept {
+			++counters.rebalances;
+			if (height)
+				counters.height = height;
+		}
+		container_stats snapshot() const noexcept { return counters; }
+	protected:
+		container_stats counters;
+	};
+}
@@ -0,0 +1,336 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "container_stats.h"
+#include "dynamic_array.h"
+#include "memory_resource.h"
+#include "serialization.h"
+
+namespace pz {
+	// Priority queue kept as an implicit heap in which every node has [Arity] children
+	// The children of a node sit next to each other in one array, so choosing which one to follow reads
+	// one or two cache lines, and the tree is only log(n) / log(Arity) levels deep.
+	// With 4 or 8 children that means far fewer cache misses per operation than a binary heap or a tree.
+	// top() is the element that comes first under [Compare], the smallest for std::less.
+	// push returns a handle that can later change or erase that element wherever it has moved to.
+	// Storage comes from a std::pmr::memory_resource, the default resource unless one is given.
+	// [Stats] is the statistics policy, see container_stats.h.
+	template <typename T, std::size_t Arity = 4, typename Compare = std::less<>, typename Stats = no_stats>
+	struct d_ary_heap : protected Stats {
+		static_assert(Arity >= 2, "A heap needs at least two children per node");
+
+		// Identifies a pushed element until it is popped or erased, after which it may be reused
+		using handle = std::size_t;
+
+		// Creates an empty heap
+		explicit d_ary_heap(Compare comparison = Compare{}, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: comp(std::move(comparison)), entries(0, resource), positions(0, resource), free_handles(0, resource) {}
+
+		// Creates a heap of the elements from [first] to [last], with handles numbered from 0 in the range's order
+		// Takes O(n) time.
+		template <typename Iter>
+		d_ary_heap(Iter first, Iter last, Compare comparison = Compare{}, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: d_ary_heap(std::move(comparison), resource) {
+			heapify(first, last);
+		}
+
+		// Adds an element and returns its handle
+		// Takes O(log n) time, log base Arity.
+		handle push(const T& element) { return emplace(element); }
+		handle push(T&& element) { return emplace(std::move(element)); }
+
+		// Constructs an element from [args], adds it and returns its handle
+		// Takes O(log n) time.
+		template <typename... Args>
+		handle emplace(Args&&... args) {
+			const handle id = new_handle();
+			try {
+				entries.emplace_back(entry{ T(std::forward<Args>(args)...), id });
+			}
+			catch (...) {
+				free_handles.push_back(id);
+				throw;
+			}
+			sift_up(entries.size() - 1);
+			return id;
+		}
+
+		// Returns the first element under the comparison
+		// Takes O(1) time.
+		const T& top() const {
+			if (entries.empty())
+				throw std::out_of_range("Heap is empty");
+			return entries.data()->value;
+		}
+
+		// Returns the handle of the top element
+		// Takes O(1) time.
+		handle top_handle() const {
+			if (entries.empty())
+				throw std::out_of_range("Heap is empty");
+			return entries.data()->id;
+		}
+
+		// Removes and returns the top element
+		// Takes O(log n) time, looking at Arity children per level.
+		T pop() {
+			if (entries.empty())
+				throw std::out_of_range("Heap is empty");
+			entry* slots = entries.data();
+			T top_value = std::move(slots[0].value);
+			const handle id = slots[0].id;
+			const std::size_t last = entries.size() - 1;
+			// The root can only move down, so the last entry takes its place without comparing against the moved-from root
+			if (last)
+				place(0, std::move(slots[last]));
+			entries.pop_back();
+			if (last)
+				sift_down(0);
+			release(id);
+			return top_value;
+		}
+
+		// Replaces the contents with the elements from [first] to [last], with handles numbered from 0 in the range's order
+		// Floyd's method sifts down each parent from the last one up, which takes O(n) time rather than n pushes' O(n log n).
+		// Takes O(n) time.
+		template <typename Iter>
+		void heapify(Iter first, Iter last) {
+			clear();
+			for (; first != last; ++first) {
+				const handle id = positions.size();
+				entries.emplace_back(entry{ T(*first), id });
+				positions.push_back(id);
+			}
+			const std::size_t n = entries.size();
+			if (n < 2)
+				return;
+			for (std::size_t i = (n - 2) / Arity + 1; i-- > 0;)
+				sift_down(i);
+		}
+
+		// Returns whether [id] refers to an element still in the heap
+		// Takes O(1) time.
+		bool contains(const handle id) const noexcept { return id < positions.size() && positions.data()[id] != npos; }
+
+		// Returns the element with handle [id]
+		// Takes O(1) time.
+		const T& value(const handle id) const { return entries.data()[position(id)].value; }
+
+		// Changes the element with handle [id] to [element], moving it up or down to where it now belongs
+		// Takes O(log n) time.
+		void update(const handle id, T element) {
+			const std::size_t pos = position(id);
+			const bool earlier = comp(element, entries.data()[pos].value);
+			entries.data()[pos].value = std::move(element);
+			if (earlier)
+				sift_up(pos);
+			else
+				sift_down(pos);
+		}
+
+		// Changes the element with handle [id] to [element], which must not come after it, e.g. a shorter distance in Dijkstra's algorithm
+		// Only moves the element up, comparing against one parent per level.
+		// Throws std::invalid_argument if [element] comes after the current value.
+		// Takes O(log n) time.
+		void decrease_key(const handle id, T element) {
+			const std::size_t pos = position(id);
+			if (comp(entries.data()[pos].value, element))
+				throw std::invalid_argument("New key comes after the current one");
+			entries.data()[pos].value = std::move(element);
+			sift_up(pos);
+		}
+
+		// Removes the element with handle [id] from wherever it is in the heap
+		// Takes O(log n) time.
+		void erase(const handle id) { remove_at(position(id)); }
+
+		// Returns the number of elements in the heap.
+		// Takes O(1) time.
+		std::size_t size() const noexcept { return entries.size(); }
+
+		// Returns whether the heap is empty.
+		// Takes O(1) time.
+		bool empty() const noexcept { return entries.empty(); }
+
+		// Preallocates room for [count] elements, so pushing and popping up to that many allocates nothing
+		// Takes O(n) time.
+		void reserve(const std::size_t count) {
+			entries.reserve(count);
+			positions.reserve(count);
+			free_handles.reserve(count);
+		}
+
+		// Removes all elements, invalidating every handle
+		// Takes O(n) time.
+		void clear() {
+			entries.clear();
+			positions.clear();
+			free_handles.clear();
+		}
+
+		// Copy all elements into a vector in heap order, not sorted.
+		// Takes O(n) time.
+		std::vector<T> to_vector() const {
+			std::vector<T> vec;
+			vec.reserve(entries.size());
+			for (const entry& e : entries)
+				vec.push_back(e.value);
+			return vec;
+		}
+
+		// Output the heap in heap order to an output stream.
+		// Takes O(n) time.
+		friend std::ostream& operator<<(std::ostream& os, const d_ary_heap& heap) {
+			os << '[';
+			for (std::size_t i = 0; i < heap.entries.size(); ++i) {
+				if (i)
+					os << ", ";
+				os << heap.entries.data()[i].value;
+			}
+			return os << ']';
+		}
+
+		// Writes the elements in heap order in the binary format from serialization.h
+		// Handles aren't written, as they only mean something to the heap that gave them out.
+		// Takes O(n) time.
+		void serialize(byte_sink& sink) const {
+			write_serial_header<T>(sink, entries.size());
+			for (const entry& e : entries)
+				serial_traits<T>::write(sink, e.value);
+		}
+
+		// Reads a heap written by serialize(), or by any other pz container holding the same type, with handles numbered from 0
+		// Takes O(n) time.
+		static d_ary_heap deserialize(byte_source& source, Compare comparison = Compare{}, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			const auto values = dynamic_array<T>::deserialize(source, resource);
+			return d_ary_heap(values.begin(), values.end(), std::move(comparison), resource);
+		}
+
+		// Returns what the statistics policy has recorded.
+		// Takes O(1) time.
+		container_stats stats() const noexcept { return Stats::snapshot(); }
+
+		// Returns the memory resource the heap allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return entries.resource(); }
+	protected:
+		// Heap slot, carrying its handle so the handle's position can be updated whenever the slot moves
+		struct entry {
+			T value;
+			handle id;
+		};
+
+		// Position of a handle that is not in the heap
+		static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+		std::size_t position(const handle id) const {
+			if (!contains(id))
+				throw std::out_of_range("Handle not in heap");
+			return positions.data()[id];
+		}
+
+		handle new_handle() {
+			if (!free_handles.empty()) {
+				const handle id = free_handles.data()[free_handles.size() - 1];
+				free_handles.pop_back();
+				return id;
+			}
+			positions.push_back(npos);
+			return positions.size() - 1;
+		}
+
+		// Moves [e] into slot [pos] and records where its handle now is
+		void place(const std::size_t pos, entry&& e) {
+			entries.data()[pos] = std::move(e);
+			positions.data()[entries.data()[pos].id] = pos;
+		}
+
+		// Removes the entry at [pos] by moving the last entry into its place
+		void remove_at(const std::size_t pos) {
+			entry* slots = entries.data();
+			const handle id = slots[pos].id;
+			const std::size_t last = entries.size() - 1;
+			if (pos != last) {
+				const bool earlier = comp(slots[last].value, slots[pos].value);
+				place(pos, std::move(slots[last]));
+				entries.pop_back();
+				if (earlier)
+					sift_up(pos);
+				else
+					sift_down(pos);
+			}
+			else
+				entries.pop_back();
+			release(id);
+		}
+
+		// Marks [id] as no longer in the heap, so a later push can reuse it
+		void release(const handle id) {
+			positions.data()[id] = npos;
+			free_handles.push_back(id);
+		}
+
+		// Moves the entry at [pos] up until its parent comes no later
+		// The entry is held aside and parents are moved down into the hole, rather than swapping at every level.
+		void sift_up(std::size_t pos) {
+			entry* slots = entries.data();
+			entry moving = std::move(slots[pos]);
+			std::size_t steps = 0;
+			while (pos) {
+				const std::size_t parent = (pos - 1) / Arity;
+				if (!comp(moving.value, slots[parent].value))
+					break;
+				place(pos, std::move(slots[parent]));
+				pos = parent;
+				++steps;
+			}
+			place(pos, std::move(moving));
+			Stats::on_traverse(steps);
+		}
+
+		// Moves the entry at [pos] down until none of its children come earlier
+		void sift_down(std::size_t pos) {
+			entry* slots = entries.data();
+			const std::size_t n = entries.size();
+			entry moving = std::move(slots[pos]);
+			std::size_t steps = 0;
+			while (true) {
+				const std::size_t first_child = pos * Arity + 1;
+				if (first_child >= n)
+					break;
+
+				// The children are contiguous, so this scan stays within a cache line or two
+				const std::size_t end_child = (n - first_child > Arity) ? first_child + Arity : n;
+				std::size_t best = first_child;
+				for (std::size_t child = first_child + 1; child < end_child; ++child)
+					if (comp(slots[child].value, slots[best].value))
+						best = child;
+
+				if (!comp(slots[best].value, moving.value))
+					break;
+				place(pos, std::move(slots[best]));
+				pos = best;
+				++steps;
+			}
+			place(pos, std::move(moving));
+			Stats::on_traverse(steps);
+		}
+
+		Compare comp;
+		dynamic_array<entry> entries;
+
+		// Position in entries of each handle, npos once it has left the heap
+		dynamic_array<std::size_t> positions;
+		dynamic_array<handle> free_handles;
+	};
+
+	// Heap with 4 children per node, whose 16 byte entries for 4 or 8 byte keys fill a 64 byte cache line
+	template <typename T, typename Compare = std::less<>, typename Stats = no_stats>
+	using quaternary_heap = d_ary_heap<T, 4, Compare, Stats>;
+}
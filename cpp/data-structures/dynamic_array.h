@@ -4,48 +4,159 @@
 #include <sstream>
 #include <algorithm>
 #include <utility>
-#include <cmath>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <string>
+#include <cstdint>
+#include "container_stats.h"
+#include "array_view.h"
+#include "memory_resource.h"
+#include "serialization.h"
+
+// File-backed arrays need mmap
+#if defined(__unix__) || defined(__APPLE__)
+#define PZ_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define PZ_HAS_MMAP 0
+#endif
 
 namespace pz {
+	// How the pages of a mapped dynamic_array will be used, passed on to the kernel with madvise
+	enum class map_advice { normal, sequential, random, will_need };
+
+	// Settings for dynamic_array::map_file
+	struct map_options {
+		// Asks for transparent huge pages where the kernel and filesystem support them, cutting TLB misses on big arrays
+		bool huge_pages = false;
+
+		map_advice advice = map_advice::normal;
+
+		// Elements to make room for when the file is created
+		std::size_t initial_capacity = 0;
+	};
+
+	// Header at the start of a mapped dynamic_array's file, the elements start right after it
+	struct alignas(64) map_header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t element_size;
+		std::uint64_t count;
+	};
+
+	// Uninitialised room for [N] elements inside a dynamic_array
+	template <typename T, std::size_t N>
+	struct dynamic_array_inline {
+		T* inline_data() noexcept { return reinterpret_cast<T*>(bytes); }
+	private:
+		alignas(T) unsigned char bytes[N * sizeof(T)];
+	};
 	template <typename T>
-	struct dynamic_array {
-		dynamic_array(size_t count = 0) : visible(count), allocated(count), arr(new T[count]) {}
+	struct dynamic_array_inline<T, 0> {
+		T* inline_data() noexcept { return nullptr; }
+	};
+
+	// Array that grows as elements are added
+	// Storage is allocated raw and elements are constructed in place, so spare capacity costs no constructor calls.
+	// Trivially copyable types grow with realloc, which can extend the block in place and otherwise moves it with one memcpy.
+	// The first [Inline] elements are stored inside the array itself, and only more than that go to the heap.
+	// Heap storage comes from a std::pmr::memory_resource, the default resource unless one is given.
+	// [Stats] is the statistics policy, see container_stats.h.
+	template <typename T, typename Stats = no_stats, std::size_t Inline = 0>
+	struct dynamic_array : protected Stats, private dynamic_array_inline<T, Inline> {
+		// Creates an array of [count] value-initialised elements, allocating nothing when they fit inline
+		// Takes O(n) time.
+		dynamic_array(size_t count = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : memory(resource) {
+			if (count > allocated) {
+				arr = allocate(count);
+				allocated = count;
+			}
+			try {
+				std::uninitialized_value_construct_n(arr, count);
+			}
+			catch (...) {
+				deallocate(arr, allocated);
+				throw;
+			}
+			visible = count;
+		}
 		// Copy constructor, copies all elements from the other array rather referencing it
+		// Like the std::pmr containers, the copy uses [resource] rather than the other array's resource.
+		// Takes O(n) time.
+		dynamic_array(const dynamic_array& dyn_arr, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : memory(resource) {
+			append(dyn_arr.begin(), dyn_arr.end());
+		}
+		// Creates an array holding copies of the elements of [view], in the view's order
+		// For taking ownership of a slice.
 		// Takes O(n) time.
-		dynamic_array(const dynamic_array<T>& dyn_arr) {
-			allocated = (visible = dyn_arr.visible);
-			arr = new T[allocated];
-			std::copy(dyn_arr.begin(), dyn_arr.end(), arr);
+		explicit dynamic_array(const array_view<const T> view, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : memory(resource) {
+			reserve(view.size());
+			append(view.begin(), view.end());
 		}
 		// Move constructor
-		dynamic_array(dynamic_array<T>&& dyn_arr) noexcept {
-			visible = std::exchange(dyn_arr.visible, 0);
-			allocated = std::exchange(dyn_arr.allocated, 0);
-			power = std::exchange(dyn_arr.power, 0);
-			arr = std::exchange(dyn_arr.arr, nullptr);
+		// Takes O(1) time, or O(n) when the other array's elements are inline and have to be moved one by one.
+		dynamic_array(dynamic_array&& dyn_arr) noexcept(!Inline || std::is_nothrow_move_constructible<T>::value)
+			: Stats(std::move(dyn_arr)), memory(dyn_arr.memory), file(std::exchange(dyn_arr.file, -1)), hints(dyn_arr.hints) {
+			if (dyn_arr.is_inline()) {
+				std::uninitialized_move(dyn_arr.arr, dyn_arr.arr + dyn_arr.visible, arr);
+				visible = dyn_arr.visible;
+				dyn_arr.clear();
+			}
+			else {
+				visible = std::exchange(dyn_arr.visible, 0);
+				allocated = std::exchange(dyn_arr.allocated, Inline);
+				arr = std::exchange(dyn_arr.arr, dyn_arr.inline_data());
+			}
 		}
 
 		~dynamic_array() {
-			delete[] arr;
+			if (is_mapped())
+				unmap();
+			else
+				clear();
 		}
-		// Add an element to the array.
-		void push_back(const T element) {
-			if (visible >= allocated) {
-				//// Allocate more space to the array. 
-				// O(n) time. Allocated space increases by n space.
-
-				// Creating the new array
-				allocated = std::pow(2U, power++);
-				T* new_arr = new T[allocated];
-
-				// Move all elements from old array to new array.
-				std::move(arr, arr + visible, new_arr);
 
-				// Replace old array with new array.
-				delete[] arr;
-				arr = new_arr;
+		// Opens the file at [path] as the array's storage, creating it if it doesn't exist
+		// An existing file is mapped in place with nothing read or copied, so reopening even a huge array is instant,
+		// and the file can be larger than physical memory. Growing extends the file with ftruncate and remaps it.
+		// The element count is saved to the file by sync() and when the array is destroyed.
+		// Only for trivially copyable types, on systems with mmap.
+		// Takes O(1) time.
+		static dynamic_array map_file(const std::string& path, const map_options& options = {}) {
+			static_assert(std::is_trivially_copyable<T>::value && alignof(T) <= alignof(map_header),
+				"Mapped arrays hold raw bytes, so elements must be trivially copyable");
+			dynamic_array mapped;
+			mapped.open_mapping(path, options);
+			return mapped;
+		}
+		// Add an element to the array.
+		// Takes O(1) amortized time, as the capacity grows geometrically.
+		void push_back(const T& element) { emplace_back(element); }
+		void push_back(T&& element) { emplace_back(std::move(element)); }
+
+		// Constructs an element at the back of the array from [args] and returns it
+		// Takes O(1) amortized time.
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			if (visible < allocated)
+				::new (static_cast<void*>(arr + visible)) T(std::forward<Args>(args)...);
+			else {
+				// The arguments may refer to an element about to be relocated, so build the new one first
+				T element(std::forward<Args>(args)...);
+				relocate(grown_capacity(visible + 1));
+				::new (static_cast<void*>(arr + visible)) T(std::move(element));
 			}
-			arr[visible++] = std::move(element);
+			return arr[visible++];
 		}
 		// For reading from an index.
 		// Takes O(1) time.
@@ -64,89 +175,91 @@ namespace pz {
 			else
 				throw std::out_of_range("Index out of range");
 		}
+		// Returns a view of the elements from inclusive start to exclusive end, without copying them
+		// The view is invalidated by anything that reallocates the array, such as growing past its capacity.
+		// Takes O(1) time.
+		array_view<T> slice(const std::size_t start, const std::size_t end) {
+			return view().slice(start, end);
+		}
+		array_view<const T> slice(const std::size_t start, const std::size_t end) const {
+			return view().slice(start, end);
+		}
+
+		// Returns a view of every element, to be reversed, strided or sliced further
+		// Takes O(1) time.
+		array_view<T> view() noexcept { return array_view<T>(arr, visible); }
+		array_view<const T> view() const noexcept { return array_view<const T>(arr, visible); }
+
 		// Creates copy array from inclusive start to exclusive end.
+		// Use slice() instead when a view of the elements is enough.
 		// Takes O(n) time.
-		dynamic_array<T> sub_array(const std::size_t start, const std::size_t end, const bool reverse = false) const {
+		dynamic_array sub_array(const std::size_t start, const std::size_t end, const bool reverse = false) const {
 			// Only allow the function to work if the start and end positions are valid
 			if (start < visible && end <= visible) {
-				// Create an array with the length
-				dynamic_array<T> sub(end - start);
-
-				// Copy the elements to the new array. Takes (end-start) time
-				if (!reverse)
-					std::copy(arr + start, arr + end, sub.begin());
-				else
-					std::reverse_copy(arr + start, arr + end, sub.begin());
-
+				// Copy the elements straight into the new array's uninitialised storage, from the same resource
+				dynamic_array sub(0, memory);
+				if (start < end) {
+					sub.reserve(end - start);
+					if (!reverse)
+						sub.append(arr + start, arr + end);
+					else
+						sub.append(std::make_reverse_iterator(arr + end), std::make_reverse_iterator(arr + start));
+				}
 				return sub;
 			}
 			else
 				throw std::out_of_range("Index out of range");
 		}
 
-		// Joins two arrays together resulting in a new one. 
+		// Joins two arrays together resulting in a new one.
 		// Takes O(n) time.
-		dynamic_array<T> operator+(const dynamic_array<T>& other) {
-			// Create an array big enough to accomodate all the values
-			const auto new_size = visible + other.visible;
-			dynamic_array<T> out(new_size);
-
-			// Copy elements into the new array
-			std::copy(arr, arr + visible, out.begin());
-
-			// Copy onto where the first array ended
-			std::copy(other.begin(), other.end(), out.begin() + visible);
+		dynamic_array operator+(const dynamic_array& other) {
+			// Create an array big enough to accomodate all the values, from the same resource
+			dynamic_array out(0, memory);
+			out.reserve(visible + other.visible);
+
+			// Copy elements into the new array, then onto where the first array ended
+			out.append(arr, arr + visible);
+			out.append(other.begin(), other.end());
 			return out;
 		}
 
-		// Extend an array using another array. 
+		// Extend an array using another array.
+		// Grows the same way as push_back, so repeated extends take O(n) amortized time in total.
 		// Takes O(n) time.
-		void extend(const dynamic_array<T>& other) {
-			// Get total number of elements
-			const auto new_size = other.visible + visible;
-
-			// If all elements are able to fit in the existing array, copy them in.
-			if (new_size <= allocated) {
-				std::copy(other.begin(), other.end(), arr + visible);
-			}
-			// If not, create a brand new array with the capacity to fit both
-			else {
-				// Create new array
-				T* new_arr = new T[new_size];
-
-				// Copy values from original array to new array
-				std::move(arr, arr + visible, new_arr);
-
-				// Copy the values from the other array
-				std::copy(other.begin(), other.end(), new_arr + visible);
-
-				// Change sizes to match and replace original array with new larger array
-				power = 0U;
-				allocated = new_size;
-				delete[] arr;
-				arr = new_arr;
-			}
-			visible = new_size;
+		void extend(const dynamic_array& other) {
+			// Appending an array to itself reads elements that relocating would move, so grow before reading them
+			if (&other == this)
+				reserve(grown_capacity(2 * visible));
+			append(other.begin(), other.end());
 		}
 
-		// Removes all elements and deallocates the memory. 
-		// Takes O(1) time.
+		// Removes all elements and deallocates the memory.
+		// A mapped array keeps its file and mapping, and is just emptied.
+		// Takes O(1) time for trivially destructible types, otherwise O(n).
 		void clear() {
-			// Deletes the array
-			delete[] arr;
-			arr = nullptr;
+			if (is_mapped()) {
+				visible = 0;
+				return;
+			}
+			std::destroy_n(arr, visible);
+			deallocate(arr, allocated);
 
-			// All set to 0 to allow push back to reallocate the array.
+			// Back to the inline storage, if any, so push back reallocates once that is full.
+			arr = this->inline_data();
 			visible = 0;
-			allocated = 0;
-			power = 0;
+			allocated = Inline;
 		}
 
-		// Returns the number of elements in the array. 
+		// Returns the number of elements in the array.
 		// Takes O(1) time.
 		std::size_t size() const noexcept { return visible; }
 
-		// Returns a pointer to the first element. 
+		// Returns the number of elements the array can hold before it has to grow.
+		// Takes O(1) time.
+		std::size_t capacity() const noexcept { return allocated; }
+
+		// Returns a pointer to the first element.
 		// Takes O(1) time.
 		T* begin() const { return arr; }
 
@@ -156,8 +269,14 @@ namespace pz {
 
 		// Allows the array to be displayed using cout.
 		// Takes O(n) time.
-		friend std::ostream& operator<<(std::ostream& os, const dynamic_array<T>& dyn_arr) {
-			return os << dyn_arr.to_ss().str();
+		friend std::ostream& operator<<(std::ostream& os, const dynamic_array& dyn_arr) {
+			os << '[';
+			for (std::size_t i = 0; i < dyn_arr.visible; ++i) {
+				if (i)
+					os << ", ";
+				os << dyn_arr.arr[i];
+			}
+			return os << ']';
 		}
 
 		// Returns whether the area is empty.
@@ -165,12 +284,11 @@ namespace pz {
 		bool empty() const noexcept { return !visible; }
 
 		// Remove the element at the back of the array.
+		// The slot is kept for the next push_back.
 		// Takes O(1) time.
 		void pop_back() noexcept {
-			// Doesn't actually remove it, just reduces the visible size
-			// Removing what is already there is pointless because as soon as something gets added, it will be replaced anyway
 			if (visible)
-				--visible;
+				std::destroy_at(arr + --visible);
 		}
 		// Remove the element at that index from the array.
 		// Takes O(n) time.
@@ -178,11 +296,12 @@ namespace pz {
 			// Moves back all elements by one starting from the element after the one being removed
 			// Does nothing if the size is 0.
 			// Takes (size - index) time;
-			
+
 			if (visible && index < visible) {
-				for (; index < visible; ++index)
+				Stats::on_traverse(visible - index - 1);
+				for (; index + 1 < visible; ++index)
 					arr[index] = std::move(arr[index + 1]);
-				--visible;
+				std::destroy_at(arr + --visible);
 			}
 
 		}
@@ -201,12 +320,39 @@ namespace pz {
 			ss << ']';
 			return ss;
 		}
+		// Writes the array in the binary format from serialization.h
+		// Trivially copyable elements are written with one copy.
+		// Takes O(n) time.
+		void serialize(pz::byte_sink& sink) const {
+			write_serial_header<T>(sink, visible);
+			write_elements(sink, arr, visible);
+		}
+
+		// Reads an array written by serialize(), or by any other pz container holding the same type
+		// Trivially copyable elements are read straight into the array's storage.
+		// Takes O(n) time.
+		static dynamic_array deserialize(pz::byte_source& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			const std::size_t count = read_serial_header<T>(source);
+			dynamic_array out(0, resource);
+			out.reserve(count);
+			if constexpr (serial_traits<T>::bulk) {
+				source.read(out.arr, count * sizeof(T));
+				out.visible = count;
+			}
+			else
+				for (std::size_t i = 0; i < count; ++i)
+					out.emplace_back(serial_traits<T>::read(source));
+			return out;
+		}
+
+		// Writes the array as text in the same form as operator<<, without going through iostreams
+		// Takes O(n) time.
+		void write_text(pz::byte_sink& sink) const { write_text_list(sink, arr, arr + visible); }
+
 		// Copy all elements into a vector to be outputted.
-		// Takes O(n) time. 
+		// Takes O(n) time.
 		std::vector<T> to_vector() {
-			std::vector<T> vec(visible);
-			std::copy(arr, arr + visible, vec.begin());
-			return vec;
+			return std::vector<T>(arr, arr + visible);
 		}
 		// Return the internal array.
 		// Takes O(1) time.
@@ -216,39 +362,281 @@ namespace pz {
 		// Takes O(n) time.
 		void reserve(const std::size_t count) {
 			// Avoids allocating more space when enough is allocated
-			if (count > allocated) {
-				T* new_arr = new T[count];
+			if (count > allocated)
+				relocate(count);
+		}
 
-				// Copy all elements through to the new array
-				for (auto i = 0u; i < visible; ++i)
-					new_arr[i] = std::move(arr[i]);
+		// Returns what the statistics policy has recorded.
+		// Takes O(1) time.
+		container_stats stats() const noexcept { return Stats::snapshot(); }
 
-				// Change the array and size
-				power = 0;
-				allocated = count;
-				delete[] arr;
-				arr = new_arr;
+		// Returns the memory resource the array allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return memory; }
+
+		// Returns whether the array is backed by a file, see map_file.
+		// Takes O(1) time.
+		bool is_mapped() const noexcept { return file >= 0; }
+
+		// Saves the element count to a mapped array's file and writes its changed pages to disk
+		// Does nothing for an array that isn't mapped.
+		// Takes O(n) time in the changed pages.
+		void sync() {
+#if PZ_HAS_MMAP
+			if (is_mapped()) {
+				mapped_header()->count = visible;
+				if (::msync(mapped_header(), mapped_bytes(allocated), MS_SYNC))
+					throw std::runtime_error("Failed syncing mapped array");
 			}
+#endif
 		}
-		
+
 	private:
-		static std::size_t log2(std::size_t num) {
-			std::size_t count{0};
-			for (; num > 1; num /= 2)
-				++count;
-			return count;
+		// Whether elements can be moved between blocks as raw bytes, letting realloc do the growing
+		static constexpr bool trivially_relocatable = std::is_trivially_copyable<T>::value && alignof(T) <= alignof(std::max_align_t);
+
+		// Capacity to grow to so that [required] elements fit
+		// Doubles the current capacity, starting from a cache line's worth, so n appends relocate O(n) elements in total.
+		// Takes O(1) time.
+		std::size_t grown_capacity(const std::size_t required) const noexcept {
+			constexpr std::size_t least = std::max<std::size_t>(64 / sizeof(T), 1);
+			return std::max({ required, 2 * allocated, least });
+		}
+
+		// Copies [first, last) onto the back of the array, growing it once beforehand when the length is known
+		// Takes O(n) time.
+		template <typename Iter>
+		void append(Iter first, Iter last) {
+			if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>::value) {
+				const auto count = static_cast<std::size_t>(std::distance(first, last));
+				if (visible + count > allocated)
+					relocate(grown_capacity(visible + count));
+				std::uninitialized_copy(first, last, arr + visible);
+				visible += count;
+			}
+			else
+				for (; first != last; ++first)
+					emplace_back(*first);
+		}
+
+		// Moves the elements into storage for [count] elements and releases the old storage
+		// Trivially relocatable types go through realloc when the storage came from malloc, and memcpy otherwise.
+		// Other types are moved, or copied when moving could throw.
+		// Takes O(n) time.
+		void relocate(const std::size_t count) {
+			check_capacity(count);
+			if (is_mapped()) {
+				remap(count);
+				return;
+			}
+			if constexpr (trivially_relocatable) {
+				if (uses_malloc() && !is_inline()) {
+					void* grown = std::realloc(arr, count * sizeof(T));
+					if (!grown)
+						throw std::bad_alloc();
+					Stats::on_allocate(count * sizeof(T));
+					// realloc only copies when it couldn't extend the block where it was
+					if (grown != arr)
+						Stats::on_move(visible * sizeof(T));
+					arr = static_cast<T*>(grown);
+					allocated = count;
+					return;
+				}
+			}
+			T* new_arr = allocate(count);
+			if constexpr (trivially_relocatable) {
+				if (visible)
+					std::memcpy(static_cast<void*>(new_arr), static_cast<const void*>(arr), visible * sizeof(T));
+			}
+			else {
+				try {
+					if constexpr (std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value)
+						std::uninitialized_move(arr, arr + visible, new_arr);
+					else
+						std::uninitialized_copy(arr, arr + visible, new_arr);
+				}
+				catch (...) {
+					deallocate(new_arr, count);
+					throw;
+				}
+			}
+			Stats::on_move(visible * sizeof(T));
+			std::destroy_n(arr, visible);
+			deallocate(arr, allocated);
+			arr = new_arr;
+			allocated = count;
 		}
+
+		// Whether storage comes from malloc rather than the resource, so relocate can realloc it
+		// That is when the resource is plain new and delete anyway and the elements can be moved as bytes.
+		bool uses_malloc() const noexcept {
+			return trivially_relocatable && memory == std::pmr::new_delete_resource();
+		}
+
+		// Throws std::length_error if [count] elements, plus a mapped array's header, would need more bytes than a size_t can count
+		static void check_capacity(const std::size_t count) {
+			if (count > (std::numeric_limits<std::size_t>::max() - sizeof(map_header)) / sizeof(T))
+				throw std::length_error("Array too large");
+		}
+
+		// Allocates uninitialised storage for [count] elements
+		T* allocate(const std::size_t count) {
+			check_capacity(count);
+			void* block;
+			if (uses_malloc()) {
+				block = std::malloc(count * sizeof(T));
+				if (!block)
+					throw std::bad_alloc();
+			}
+			else
+				block = memory->allocate(count * sizeof(T), alignof(T));
+			Stats::on_allocate(count * sizeof(T));
+			return static_cast<T*>(block);
+		}
+
+		// Releases storage for [count] elements from allocate, whose elements must already be destroyed, and ignores the inline storage
+		void deallocate(T* block, const std::size_t count) noexcept {
+			if (!block || is_inline(block))
+				return;
+			if (uses_malloc())
+				std::free(block);
+			else
+				memory->deallocate(block, count * sizeof(T), alignof(T));
+		}
+
+		// Bytes of a mapped array's file holding [count] elements
+		static std::size_t mapped_bytes(const std::size_t count) noexcept { return sizeof(map_header) + count * sizeof(T); }
+
+		map_header* mapped_header() const noexcept {
+			return reinterpret_cast<map_header*>(reinterpret_cast<char*>(arr) - sizeof(map_header));
+		}
+
+#if PZ_HAS_MMAP
+		// Flags saved from map_options, reapplied whenever the mapping is replaced
+		static constexpr unsigned hint_huge_pages = 1, hint_advice_shift = 1;
+
+		// Maps the file at [path], creating it with room for the initial capacity if it is empty
+		void open_mapping(const std::string& path, const map_options& options) {
+			const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+			if (fd < 0)
+				throw std::runtime_error("Could not open " + path);
+			try {
+				struct stat info;
+				if (::fstat(fd, &info))
+					throw std::runtime_error("Could not read the size of " + path);
+				const bool created = !info.st_size;
+				if (!created && std::size_t(info.st_size) < sizeof(map_header))
+					throw std::runtime_error(path + " is not a mapped array");
+				const std::size_t capacity = created ? options.initial_capacity : (std::size_t(info.st_size) - sizeof(map_header)) / sizeof(T);
+				if (created && ::ftruncate(fd, off_t(mapped_bytes(capacity))))
+					throw std::runtime_error("Could not size " + path);
+
+				void* base = ::mmap(nullptr, mapped_bytes(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if (base == MAP_FAILED)
+					throw std::runtime_error("Could not map " + path);
+				map_header* header = static_cast<map_header*>(base);
+				if (created) {
+					std::memcpy(header->magic, "pzarray", 8);
+					header->version = 1;
+					header->element_size = sizeof(T);
+					header->count = 0;
+				}
+				else if (std::memcmp(header->magic, "pzarray", 8) || header->version != 1 || header->element_size != sizeof(T)
+					|| header->count > capacity) {
+					::munmap(base, mapped_bytes(capacity));
+					throw std::runtime_error(path + " is not a mapped array of this element type");
+				}
+
+				file = fd;
+				hints = (options.huge_pages ? hint_huge_pages : 0) | (unsigned(options.advice) << hint_advice_shift);
+				arr = reinterpret_cast<T*>(header + 1);
+				allocated = capacity;
+				visible = std::size_t(header->count);
+				advise();
+			}
+			catch (...) {
+				::close(fd);
+				throw;
+			}
+		}
+
+		// Extends the file to hold [count] elements and maps the larger file, moving the mapping if it must
+		// Only page table entries move, never the data.
+		void remap(const std::size_t count) {
+			if (::ftruncate(file, off_t(mapped_bytes(count))))
+				throw std::bad_alloc();
+			void* base = mapped_header();
+#if defined(__linux__)
+			void* moved = ::mremap(base, mapped_bytes(allocated), mapped_bytes(count), MREMAP_MAYMOVE);
+#else
+			::munmap(base, mapped_bytes(allocated));
+			void* moved = ::mmap(nullptr, mapped_bytes(count), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+#endif
+			if (moved == MAP_FAILED)
+				throw std::bad_alloc();
+			Stats::on_allocate((count - allocated) * sizeof(T));
+			arr = reinterpret_cast<T*>(static_cast<map_header*>(moved) + 1);
+			allocated = count;
+			advise();
+		}
+
+		// Passes the saved hints for the whole mapping on to the kernel, which is free to ignore them
+		void advise() noexcept {
+			void* base = mapped_header();
+			const std::size_t bytes = mapped_bytes(allocated);
+#if defined(MADV_HUGEPAGE)
+			if (hints & hint_huge_pages)
+				::madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+			switch (map_advice(hints >> hint_advice_shift)) {
+			case map_advice::sequential: ::madvise(base, bytes, MADV_SEQUENTIAL); break;
+			case map_advice::random: ::madvise(base, bytes, MADV_RANDOM); break;
+			case map_advice::will_need: ::madvise(base, bytes, MADV_WILLNEED); break;
+			default: break;
+			}
+		}
+
+		// Saves the element count and closes the mapping and file
+		void unmap() noexcept {
+			mapped_header()->count = visible;
+			::munmap(mapped_header(), mapped_bytes(allocated));
+			::close(file);
+			file = -1;
+			arr = this->inline_data();
+			visible = 0;
+			allocated = Inline;
+		}
+#else
+		void open_mapping(const std::string&, const map_options&) { throw std::runtime_error("Mapped arrays need mmap"); }
+		void remap(std::size_t) {}
+		void unmap() noexcept {}
+#endif
+
+		// Whether [block], the array's current storage by default, is the inline storage
+		bool is_inline(const T* block) noexcept { return Inline && block == this->inline_data(); }
+		bool is_inline() noexcept { return is_inline(arr); }
 	protected:
-		// Internal array
-		T* arr = nullptr;
+		// Where heap storage comes from
+		std::pmr::memory_resource* memory;
+
+		// Internal array, the inline storage until the elements outgrow it
+		T* arr = this->inline_data();
 
 		// Number of elements allocated
-		std::size_t allocated = 0;
+		std::size_t allocated = Inline;
 
 		// Number of accessible elements
 		std::size_t visible = 0;
 
-		// Power to be raised by when the array is expanded
-		std::size_t power = 0;
+		// Descriptor of the file a mapped array lives in, -1 when the array isn't mapped
+		int file = -1;
+
+		// Hints for the mapped file's pages, from map_options
+		unsigned hints = 0;
 	};
+
+	// dynamic_array that holds up to [N] elements inside itself before allocating
+	// Suits the many arrays that stay small, which then never touch the heap and keep their elements next to the size.
+	template <typename T, std::size_t N, typename Stats = no_stats>
+	using small_array = dynamic_array<T, Stats, N>;
 }
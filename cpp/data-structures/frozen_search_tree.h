@@ -0,0 +1,141 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+// Prefetches the cache line holding [address] for reading, where the compiler supports it
+#if defined(__GNUC__) || defined(__clang__)
+#define PZ_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PZ_PREFETCH(address) ((void)0)
+#endif
+
+template <typename T>
+// Read-only search tree in a single array in Eytzinger (breadth first) order
+// The children of the node at k sit at 2k and 2k + 1, so a search is a branchless walk down the array
+// that can prefetch the next levels ahead, and the top levels share a handful of cache lines.
+// Built from sorted values, e.g. by bst::freeze(). Only works with comparable types
+struct frozen_bst {
+	// Builds the tree from values in sorted order
+	// Takes O(n) time.
+	frozen_bst(const std::vector<T>& sorted) : count(sorted.size()), nodes(sorted.size() + 1) {
+		std::size_t next = 0;
+		// An in-order walk of the implicit tree visits its slots in sorted order
+		std::function<void(std::size_t)> fill = [this, &sorted, &next, &fill](std::size_t k) {
+			if (k <= count) {
+				fill(2 * k);
+				nodes[k] = sorted[next++];
+				fill(2 * k + 1);
+			}
+		};
+		fill(1);
+	}
+
+	/// Returns whether the structure is empty
+	// Takes O(1) time.
+	bool empty() const noexcept { return !count; }
+
+	/// Number of elements
+	// Takes O(1) time.
+	std::size_t size() const noexcept { return count; }
+
+	// Returns a pointer to the first value not less than [item], or nullptr if every value is less
+	// Takes O(log n) time.
+	const T* lower_bound(const T& item) const {
+		std::size_t k = 1;
+		while (k <= count) {
+			// Four levels down is 16 slots on, which is where the search will be in four steps
+			prefetch(16 * k);
+			k = 2 * k + (nodes[k] < item);
+		}
+		return at(resolve(k));
+	}
+
+	// Find value and return pointer to it
+	// Takes O(log n) time.
+	const T* find(const T& item) const {
+		const T* found = lower_bound(item);
+		return (found && !(item < *found)) ? found : nullptr;
+	}
+
+	// Runs lower_bound for [n] items at once, writing the results to [out]
+	// The searches advance a level at a time together, so their cache misses overlap instead of queueing.
+	// Takes O(n log size) time.
+	void lower_bound_many(const T* items, const std::size_t n, const T** out) const {
+		constexpr std::size_t group = 16;
+		for (std::size_t start = 0; start < n; start += group) {
+			const std::size_t size = std::min(group, n - start);
+			std::size_t k[group];
+			for (std::size_t i = 0; i < size; ++i)
+				k[i] = 1;
+
+			// Every search takes the same number of steps, give or take the last partial level
+			for (bool active = count > 0; active;) {
+				active = false;
+				for (std::size_t i = 0; i < size; ++i) {
+					if (k[i] <= count) {
+						prefetch(16 * k[i]);
+						k[i] = 2 * k[i] + (nodes[k[i]] < items[start + i]);
+						active = true;
+					}
+				}
+			}
+			for (std::size_t i = 0; i < size; ++i)
+				out[start + i] = at(resolve(k[i]));
+		}
+	}
+
+	// Runs find for [n] items at once, writing the results to [out]
+	// Takes O(n log size) time.
+	void find_many(const T* items, const std::size_t n, const T** out) const {
+		lower_bound_many(items, n, out);
+		for (std::size_t i = 0; i < n; ++i)
+			if (out[i] && items[i] < *out[i])
+				out[i] = nullptr;
+	}
+
+	// Finds all values and outputs them to an ordered vector
+	// Takes O(n) time.
+	std::vector<T> to_vector() const {
+		std::vector<T> arr;
+		arr.reserve(count);
+		std::function<void(std::size_t)> collect = [this, &arr, &collect](std::size_t k) {
+			if (k <= count) {
+				collect(2 * k);
+				arr.push_back(nodes[k]);
+				collect(2 * k + 1);
+			}
+		};
+		collect(1);
+		return arr;
+	}
+private:
+	// Turns the slot a search fell off the tree at into the slot of its answer
+	// The answer is the last node the search went left at, so drop the trailing right turns (1 bits) and that left turn.
+	// Takes O(1) time.
+	static std::size_t resolve(std::size_t k) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+		return k >> (__builtin_ctzll(~static_cast<unsigned long long>(k)) + 1);
+#else
+		while (k & 1)
+			k >>= 1;
+		return k >> 1;
+#endif
+	}
+
+	const T* at(const std::size_t k) const noexcept { return k ? &nodes[k] : nullptr; }
+
+	// Prefetches slot [k], which may be past the end of the tree near the bottom levels
+	// The address is worked out as an integer, as a pointer that far past the array would be undefined behaviour.
+	// Takes O(1) time.
+	void prefetch(const std::size_t k) const noexcept {
+		PZ_PREFETCH(reinterpret_cast<const void*>(reinterpret_cast<std::uintptr_t>(nodes.data()) + k * sizeof(T)));
+	}
+
+	std::size_t count;
+
+	// Values in Eytzinger order from index 1, index 0 is unused
+	std::vector<T> nodes;
+};
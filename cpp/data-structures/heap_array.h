@@ -1,37 +1,73 @@
 #pragma once
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <utility>
+#include "../algorithms/simd.h"
+#include "array_view.h"
+#include "memory_resource.h"
+#include "serialization.h"
 namespace pz {
-	template <typename T>
+	// Fixed size array on the heap
+	// Storage comes from a std::pmr::memory_resource, the default resource unless one is given,
+	// aligned to [Alignment] bytes. See aligned_heap_array for cache line aligned numeric buffers.
+	// Arrays of numbers get bulk operations that run on the SIMD kernels from simd.h.
+	template <typename T, std::size_t Alignment = alignof(T)>
 	struct heap_array {
-		heap_array(const int size) : count(size), arr(new T[size]) {}
-		heap_array(const int size, const T& fill_value) : count(size), arr(new T[size]) {
-			auto x = arr;
-			const auto end = arr + count;
-			while (x != end)
-				*x++ = fill_value;
+		static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+			"Alignment must be a power of two no less than the type's own");
+
+		heap_array(const int size, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: count(size), memory(resource), arr(allocate()) {
+			construct([this] { std::uninitialized_default_construct_n(arr, count); });
+		}
+		heap_array(const int size, const T& fill_value, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: count(size), memory(resource), arr(allocate()) {
+			construct([this, &fill_value] {
+				if constexpr (simd::supported<T>::value)
+					simd::fill(arr, std::size_t(count), fill_value);
+				else
+					std::uninitialized_fill_n(arr, count, fill_value);
+			});
 		}
 		// Copy constructor
-		heap_array(const heap_array& other): count(other.count), arr(new T[other.count]) {
-			for (auto i = 0; i < count; ++i)
-				arr[i] = other.arr[i];
+		// Like the std::pmr containers, the copy uses [resource] rather than the other array's resource.
+		heap_array(const heap_array& other, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: count(other.count), memory(resource), arr(allocate()) {
+			construct([this, &other] {
+				if constexpr (simd::supported<T>::value)
+					simd::copy(arr, other.arr, std::size_t(count));
+				else
+					std::uninitialized_copy_n(other.arr, count, arr);
+			});
 		}
 
 		T operator[](const std::size_t index) const {
-			if (index < count)
+			if (index < std::size_t(count))
 				return arr[index];
 			else
 				throw std::out_of_range("Index out of range");
 		}
 
 		T& operator[](const std::size_t index) {
-			if (index < count)
+			if (index < std::size_t(count))
 				return arr[index];
 			else
 				throw std::out_of_range("Index out of range");
 		}
 		T* begin() { return arr; }
 		T* end() { return arr + count; }
+
+		// Returns a view of the elements from inclusive start to exclusive end, without copying them
+		// Takes O(1) time.
+		array_view<T> slice(const std::size_t start, const std::size_t end) { return view().slice(start, end); }
+		array_view<const T> slice(const std::size_t start, const std::size_t end) const { return view().slice(start, end); }
+
+		// Returns a view of every element, to be reversed, strided or sliced further
+		// Takes O(1) time.
+		array_view<T> view() noexcept { return array_view<T>(arr, count); }
+		array_view<const T> view() const noexcept { return array_view<const T>(arr, count); }
 		friend std::ostream& operator <<(std::ostream& os, const heap_array& arr) {
 			os << '[';
 			if (arr.count) {
@@ -43,11 +79,123 @@ namespace pz {
 			os << ']';
 			return os;
 		}
+
+		//// Numeric operations
+		// Only for arrays of integers or floating point numbers, and vectorised with the widest instruction set available.
+
+		// Sets every element to [value]
+		// Takes O(n) time.
+		void fill(const T value) { simd::fill(arr, std::size_t(count), value); }
+
+		// Returns the sum of the elements, with integers wrapping around on overflow
+		// Takes O(n) time.
+		T sum() const { return simd::sum(arr, std::size_t(count)); }
+
+		// Returns the lowest and highest element
+		// Takes O(n) time.
+		std::pair<T, T> min_max() const { return simd::min_max(arr, std::size_t(count)); }
+
+		// Returns the sum of the products of this array's and [other]'s elements
+		// Takes O(n) time.
+		template <std::size_t OtherAlignment>
+		T dot(const heap_array<T, OtherAlignment>& other) const {
+			if (other.count != count)
+				throw std::invalid_argument("Arrays differ in size");
+			return simd::dot(arr, other.data(), std::size_t(count));
+		}
+
+		// Replaces every element x with fn(x)
+		// A generic lambda using operators, like [](auto x) { return x * 3 + 1; }, runs vectorised, see simd::transform.
+		// Takes O(n) time.
+		template <typename Fn>
+		void transform(Fn fn) { simd::transform(arr, arr, std::size_t(count), fn); }
+
+		// Returns how many elements satisfy [pred]
+		// A generic lambda of comparisons, like [](auto x) { return x > 5; }, runs vectorised, see simd::count_if.
+		// Takes O(n) time.
+		template <typename Pred>
+		std::size_t count_if(Pred pred) const { return simd::count_if(arr, std::size_t(count), pred); }
+
+		// Returns the first element.
+		// Takes O(1) time.
+		T* data() noexcept { return arr; }
+		const T* data() const noexcept { return arr; }
+
+		// Writes the array in the binary format from serialization.h
+		// Trivially copyable elements are written with one copy.
+		// Takes O(n) time.
+		void serialize(byte_sink& sink) const {
+			write_serial_header<T>(sink, count);
+			write_elements(sink, arr, count);
+		}
+
+		// Reads an array written by serialize(), or by any other pz container holding the same type
+		// Trivially copyable elements are read straight into the array's storage.
+		// Takes O(n) time.
+		static heap_array deserialize(byte_source& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			// Built in place, as heap_array has no move constructor
+			return heap_array(source, resource);
+		}
+
+		// Writes the array as text in the same form as operator<<, without going through iostreams
+		// Takes O(n) time.
+		void write_text(byte_sink& sink) const { write_text_list(sink, arr, arr + count); }
+
+		// Returns the memory resource the array allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return memory; }
+
 		~heap_array() {
-			delete[] arr;
+			std::destroy_n(arr, count);
+			memory->deallocate(arr, count * sizeof(T), Alignment);
 		}
 		const int count;
+	private:
+		// Reads the elements straight into the new array's storage, for deserialize
+		heap_array(byte_source& source, std::pmr::memory_resource* resource)
+			: count(serial_count(source)), memory(resource), arr(allocate()) {
+			construct([this, &source] {
+				if constexpr (serial_traits<T>::bulk)
+					source.read(arr, count * sizeof(T));
+				else {
+					std::uninitialized_default_construct_n(arr, count);
+					try {
+						for (int i = 0; i < count; ++i)
+							arr[i] = serial_traits<T>::read(source);
+					}
+					catch (...) {
+						std::destroy_n(arr, count);
+						throw;
+					}
+				}
+			});
+		}
+		static int serial_count(byte_source& source) {
+			const std::size_t size = read_serial_header<T>(source);
+			if (size > std::size_t(std::numeric_limits<int>::max()))
+				throw std::length_error("Serialized data is too long for a heap_array");
+			return int(size);
+		}
+
+		T* allocate() { return static_cast<T*>(memory->allocate(count * sizeof(T), Alignment)); }
+
+		// Runs [fill] to construct the elements, giving the storage back if a constructor throws
+		template <typename Fill>
+		void construct(Fill fill) {
+			try {
+				fill();
+			}
+			catch (...) {
+				memory->deallocate(arr, count * sizeof(T), Alignment);
+				throw;
+			}
+		}
 	protected:
+		std::pmr::memory_resource* memory;
 		T* arr;
 	};
+
+	// Heap array aligned to a 64 byte cache line, so vector loads never straddle lines
+	template <typename T>
+	using aligned_heap_array = heap_array<T, 64>;
 }
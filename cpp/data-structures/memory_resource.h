@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace pz {
+	// Memory resource that hands out memory by bumping a pointer through large chunks, and frees it all at once
+	// deallocate does nothing, so containers built on an arena allocate in a few instructions and free nothing,
+	// and release() or the destructor hands every chunk back to the upstream resource in one go.
+	// Chunks double in size, so n bytes take O(log n) upstream allocations. Not thread safe, use one arena per request or thread
+	struct monotonic_arena : std::pmr::memory_resource {
+		// Creates an empty arena whose first chunk holds [first_chunk] bytes
+		explicit monotonic_arena(const std::size_t first_chunk = 4096, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: upstream(upstream), next_chunk(std::max<std::size_t>(first_chunk, 64)) {}
+
+		// Creates an arena that hands out [buffer] first, e.g. an array on the stack, and only then goes upstream
+		// The buffer isn't owned by the arena, so it is never freed.
+		monotonic_arena(void* buffer, const std::size_t size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: upstream(upstream), buffer(static_cast<char*>(buffer)), buffer_size(size), current(this->buffer), end(this->buffer + size),
+			next_chunk(std::max<std::size_t>(size, 64)) {}
+
+		// Prevent the arena from being copied
+		monotonic_arena(const monotonic_arena& other) = delete;
+		void operator=(const monotonic_arena& other) = delete;
+
+		~monotonic_arena() { release(); }
+
+		// Frees every chunk at once, invalidating everything allocated from the arena
+		// The initial buffer, if any, is handed out again.
+		// Takes O(chunks) time.
+		void release() noexcept {
+			while (chunks) {
+				chunk* previous = chunks->previous;
+				upstream->deallocate(chunks, chunks->size, alignof(std::max_align_t));
+				chunks = previous;
+			}
+			current = buffer;
+			end = buffer + buffer_size;
+			used = 0;
+		}
+
+		// Bytes handed out since the arena was created or last released, including alignment padding
+		// Takes O(1) time.
+		std::size_t bytes_used() const noexcept { return used; }
+	protected:
+		// Takes O(1) time, apart from the occasional new chunk.
+		void* do_allocate(const std::size_t bytes, const std::size_t alignment) override {
+			char* start = align_up(current, alignment);
+			if (!current || start + bytes > end) {
+				add_chunk(bytes + alignment);
+				start = align_up(current, alignment);
+			}
+			used += (start + bytes) - current;
+			current = start + bytes;
+			return start;
+		}
+
+		// Memory is only given back by release()
+		void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	private:
+		// Header at the start of every chunk taken from upstream
+		struct alignas(std::max_align_t) chunk {
+			chunk* previous;
+			std::size_t size;
+		};
+
+		static char* align_up(char* ptr, const std::size_t alignment) noexcept {
+			const auto address = reinterpret_cast<std::uintptr_t>(ptr);
+			return ptr + ((alignment - address % alignment) % alignment);
+		}
+
+		// Starts a new chunk large enough for [bytes], doubling the chunk size each time
+		void add_chunk(const std::size_t bytes) {
+			const std::size_t size = std::max(next_chunk, bytes + sizeof(chunk));
+			chunk* added = static_cast<chunk*>(upstream->allocate(size, alignof(std::max_align_t)));
+			added->previous = chunks;
+			added->size = size;
+			chunks = added;
+			current = reinterpret_cast<char*>(added + 1);
+			end = reinterpret_cast<char*>(added) + size;
+			next_chunk = 2 * size;
+		}
+
+		std::pmr::memory_resource* upstream;
+		chunk* chunks = nullptr;
+
+		// Caller's buffer handed out before any chunk
+		char* buffer = nullptr;
+		std::size_t buffer_size = 0;
+
+		// Free space left in the current chunk
+		char* current = nullptr;
+		char* end = nullptr;
+
+		std::size_t next_chunk;
+		std::size_t used = 0;
+	};
+
+	// Pool resource private to the calling thread, for containers that live and die on one thread
+	// Blocks are recycled through per-size free lists without any locking. Memory from it must be freed
+	// on the thread that allocated it, before that thread exits.
+	inline std::pmr::memory_resource* thread_local_pool() {
+		thread_local std::pmr::unsynchronized_pool_resource pool;
+		return &pool;
+	}
+
+	// Allocates a [Node] from [resource] and constructs it from [args]
+	template <typename Node, typename... Args>
+	Node* make_node(std::pmr::memory_resource* resource, Args&&... args) {
+		void* block = resource->allocate(sizeof(Node), alignof(Node));
+		try {
+			return ::new (block) Node{ std::forward<Args>(args)... };
+		}
+		catch (...) {
+			resource->deallocate(block, sizeof(Node), alignof(Node));
+			throw;
+		}
+	}
+
+	// Destroys a node from make_node and gives its memory back to [resource]
+	template <typename Node>
+	void destroy_node(std::pmr::memory_resource* resource, Node* node) noexcept {
+		node->~Node();
+		resource->deallocate(node, sizeof(Node), alignof(Node));
+	}
+}
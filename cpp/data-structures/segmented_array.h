@@ -0,0 +1,354 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "array_view.h"
+#include "container_stats.h"
+#include "memory_resource.h"
+#include "serialization.h"
+
+namespace pz {
+	// Bits of the index that pick the element within a chunk, for chunks of about 64 KiB
+	template <typename T>
+	constexpr unsigned int segmented_chunk_bits() {
+		unsigned int bits = 0;
+		while (bits < 16 && (sizeof(T) << (bits + 1)) <= (std::size_t(1) << 16))
+			++bits;
+		return bits;
+	}
+
+	// Array stored in fixed size chunks of 2^[ChunkBits] elements behind a small index of chunk pointers
+	// Growing allocates one new chunk and never moves an element, so appends take the same time every time
+	// and pointers and references to elements stay valid until the element is removed.
+	// Indexing splits the index into a chunk and an offset with a shift and a mask.
+	// Chunks come from a std::pmr::memory_resource, the default resource unless one is given.
+	// [Stats] is the statistics policy, see container_stats.h.
+	template <typename T, typename Stats = no_stats, unsigned int ChunkBits = segmented_chunk_bits<T>()>
+	struct segmented_array : protected Stats {
+		// Number of elements in each chunk
+		static constexpr std::size_t chunk_size = std::size_t(1) << ChunkBits;
+
+		// Random access iterator, going through the chunk index on every access
+		// Iterators refer to the array rather than its index, so unlike std::vector's they stay valid as it grows.
+		// Use chunk() to walk a chunk at a time in the innermost loops.
+		template <typename Value>
+		struct basic_iterator {
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = std::remove_cv_t<Value>;
+			using pointer = Value*;
+			using reference = Value&;
+			using difference_type = std::ptrdiff_t;
+
+			basic_iterator() = default;
+			basic_iterator(const segmented_array* owner, const std::size_t index) : owner(owner), index(index) {}
+			// Iterators can be used as const iterators
+			operator basic_iterator<const Value>() const { return basic_iterator<const Value>(owner, index); }
+
+			reference operator*() const { return owner->chunks[index >> ChunkBits][index & (chunk_size - 1)]; }
+			pointer operator->() const { return &**this; }
+			reference operator[](const difference_type offset) const { return *(*this + offset); }
+
+			basic_iterator& operator++() { ++index; return *this; }
+			basic_iterator operator++(int) { basic_iterator temp = *this; ++index; return temp; }
+			basic_iterator& operator--() { --index; return *this; }
+			basic_iterator operator--(int) { basic_iterator temp = *this; --index; return temp; }
+			basic_iterator& operator+=(const difference_type offset) { index += offset; return *this; }
+			basic_iterator& operator-=(const difference_type offset) { index -= offset; return *this; }
+			friend basic_iterator operator+(basic_iterator it, const difference_type offset) { return it += offset; }
+			friend basic_iterator operator+(const difference_type offset, basic_iterator it) { return it += offset; }
+			friend basic_iterator operator-(basic_iterator it, const difference_type offset) { return it -= offset; }
+			friend difference_type operator-(const basic_iterator& a, const basic_iterator& b) { return difference_type(a.index - b.index); }
+
+			bool operator==(const basic_iterator& other) const { return index == other.index; }
+			bool operator!=(const basic_iterator& other) const { return index != other.index; }
+			bool operator<(const basic_iterator& other) const { return index < other.index; }
+			bool operator>(const basic_iterator& other) const { return index > other.index; }
+			bool operator<=(const basic_iterator& other) const { return index <= other.index; }
+			bool operator>=(const basic_iterator& other) const { return index >= other.index; }
+		private:
+			const segmented_array* owner = nullptr;
+			std::size_t index = 0;
+		};
+		using iterator = basic_iterator<T>;
+		using const_iterator = basic_iterator<const T>;
+
+		segmented_array() = default;
+
+		// Creates an empty array that allocates its chunks from [resource]
+		explicit segmented_array(std::pmr::memory_resource* resource) : chunks(resource) {}
+
+		// Copy constructor
+		// Like the std::pmr containers, the copy uses [resource] rather than the other array's resource.
+		// Takes O(n) time.
+		segmented_array(const segmented_array& other, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : chunks(resource) {
+			append(other.begin(), other.end());
+		}
+
+		// Move constructor
+		// Takes O(1) time.
+		segmented_array(segmented_array&& other) noexcept
+			: Stats(std::move(other)), chunks(std::move(other.chunks)), visible(std::exchange(other.visible, 0)) {
+			other.chunks.clear();
+		}
+
+		~segmented_array() {
+			clear();
+			release_spare();
+		}
+
+		// Add an element to the array.
+		// Takes O(1) time, never moving existing elements.
+		void push_back(const T& element) { emplace_back(element); }
+		void push_back(T&& element) { emplace_back(std::move(element)); }
+
+		// Constructs an element at the back of the array from [args] and returns it
+		// Takes O(1) time.
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			if (visible == capacity())
+				add_chunk();
+			T* slot = chunks[visible >> ChunkBits] + (visible & (chunk_size - 1));
+			::new (static_cast<void*>(slot)) T(std::forward<Args>(args)...);
+			++visible;
+			return *slot;
+		}
+
+		// Appends the elements from [first] to [last], filling the last chunk and then whole chunks at a time
+		// The range can be part of this array, as growing never moves elements or invalidates iterators.
+		// Takes O(n) time.
+		template <typename Iter>
+		void append(Iter first, const Iter last) {
+			using category = typename std::iterator_traits<Iter>::iterator_category;
+			if constexpr (std::is_base_of<std::random_access_iterator_tag, category>::value) {
+				reserve(visible + std::size_t(last - first));
+				while (first != last) {
+					// Copy as much as fits in the current chunk with one call
+					const std::size_t offset = visible & (chunk_size - 1);
+					const std::size_t count = std::min<std::size_t>(chunk_size - offset, std::size_t(last - first));
+					std::uninitialized_copy(first, first + count, chunks[visible >> ChunkBits] + offset);
+					first += count;
+					visible += count;
+				}
+			}
+			else
+				for (; first != last; ++first)
+					emplace_back(*first);
+		}
+
+		// Appends all elements of another array
+		// Appending an array to itself copies the elements it had before the call.
+		// Takes O(n) time.
+		void extend(const segmented_array& other) {
+			append(other.begin(), other.end());
+		}
+
+		// For reading from an index.
+		// Takes O(1) time.
+		const T& operator[](const std::size_t index) const {
+			if (index < visible)
+				return chunks[index >> ChunkBits][index & (chunk_size - 1)];
+			else
+				throw std::out_of_range("Index out of range");
+		}
+
+		// For reading from and writing to an index.
+		// Takes O(1) time.
+		T& operator[](const std::size_t index) {
+			if (index < visible)
+				return chunks[index >> ChunkBits][index & (chunk_size - 1)];
+			else
+				throw std::out_of_range("Index out of range");
+		}
+
+		T& back() { return (*this)[visible - 1]; }
+		const T& back() const { return (*this)[visible - 1]; }
+
+		// Remove the element at the back of the array.
+		// Its chunk is kept for the next push_back.
+		// Takes O(1) time.
+		void pop_back() noexcept {
+			if (visible) {
+				--visible;
+				std::destroy_at(chunks[visible >> ChunkBits] + (visible & (chunk_size - 1)));
+			}
+		}
+
+		// Removes the elements from index [count] onwards and frees every chunk left empty
+		// Takes O(1) time per freed chunk for trivially destructible types, otherwise O(n).
+		void truncate(const std::size_t count) {
+			if (count >= visible)
+				return;
+			destroy_from(count);
+			visible = count;
+			release_spare();
+		}
+
+		// Frees the chunks past the last element, keeping the one it is in
+		// Takes O(1) time per freed chunk.
+		void shrink_to_fit() { release_spare(); }
+
+		// Allocates chunks until the array can hold [count] elements without allocating again
+		// Takes O(1) time per allocated chunk.
+		void reserve(const std::size_t count) {
+			while (capacity() < count)
+				add_chunk();
+		}
+
+		// Removes all elements and frees every chunk but the first, which is kept for reuse.
+		// Takes O(chunks) time for trivially destructible types, otherwise O(n).
+		void clear() {
+			destroy_from(0);
+			visible = 0;
+			while (chunks.size() > 1)
+				free_chunk();
+		}
+
+		// Returns the number of elements in the array.
+		// Takes O(1) time.
+		std::size_t size() const noexcept { return visible; }
+
+		// Returns whether the array is empty.
+		// Takes O(1) time.
+		bool empty() const noexcept { return !visible; }
+
+		// Returns the number of elements the array can hold before it allocates another chunk.
+		// Takes O(1) time.
+		std::size_t capacity() const noexcept { return chunks.size() << ChunkBits; }
+
+		// Returns the number of chunks holding elements.
+		// Takes O(1) time.
+		std::size_t chunk_count() const noexcept { return (visible + chunk_size - 1) >> ChunkBits; }
+
+		// Returns a view of the elements in chunk [index], contiguous in memory
+		// Only the last chunk can be partly filled.
+		// Takes O(1) time.
+		array_view<T> chunk(const std::size_t index) {
+			if (index < chunk_count())
+				return array_view<T>(chunks[index], std::min(chunk_size, visible - (index << ChunkBits)));
+			else
+				throw std::out_of_range("Index out of range");
+		}
+		array_view<const T> chunk(const std::size_t index) const {
+			if (index < chunk_count())
+				return array_view<const T>(chunks[index], std::min(chunk_size, visible - (index << ChunkBits)));
+			else
+				throw std::out_of_range("Index out of range");
+		}
+
+		iterator begin() noexcept { return iterator(this, 0); }
+		iterator end() noexcept { return iterator(this, visible); }
+		const_iterator begin() const noexcept { return const_iterator(this, 0); }
+		const_iterator end() const noexcept { return const_iterator(this, visible); }
+
+		// Allows the array to be displayed using cout.
+		// Takes O(n) time.
+		friend std::ostream& operator<<(std::ostream& os, const segmented_array& arr) {
+			os << '[';
+			for (std::size_t i = 0; i < arr.visible; ++i) {
+				if (i)
+					os << ", ";
+				os << arr[i];
+			}
+			return os << ']';
+		}
+
+		// Writes the array in the binary format from serialization.h
+		// Trivially copyable elements are written a chunk at a time.
+		// Takes O(n) time.
+		void serialize(byte_sink& sink) const {
+			write_serial_header<T>(sink, visible);
+			for (std::size_t i = 0; i < chunk_count(); ++i) {
+				const auto elements = chunk(i);
+				write_elements(sink, elements.data(), elements.size());
+			}
+		}
+
+		// Reads an array written by serialize(), or by any other pz container holding the same type
+		// Trivially copyable elements are read straight into the chunks.
+		// Takes O(n) time.
+		static segmented_array deserialize(byte_source& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			const std::size_t count = read_serial_header<T>(source);
+			segmented_array out(resource);
+			if constexpr (serial_traits<T>::bulk) {
+				// Chunks are added as they are filled rather than reserved up front, so a corrupt count runs out of data, not memory
+				while (out.visible < count) {
+					const std::size_t filled = std::min(chunk_size, count - out.visible);
+					if (out.visible == out.capacity())
+						out.add_chunk();
+					source.read(out.chunks[out.visible >> ChunkBits], filled * sizeof(T));
+					out.visible += filled;
+				}
+			}
+			else
+				for (std::size_t i = 0; i < count; ++i)
+					out.emplace_back(serial_traits<T>::read(source));
+			return out;
+		}
+
+		// Writes the array as text in the same form as operator<<, without going through iostreams
+		// Takes O(n) time.
+		void write_text(byte_sink& sink) const { write_text_list(sink, begin(), end()); }
+
+		// Copy all elements into a vector to be outputted.
+		// Takes O(n) time.
+		std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+
+		// Returns what the statistics policy has recorded.
+		// Takes O(1) time.
+		container_stats stats() const noexcept { return Stats::snapshot(); }
+
+		// Returns the memory resource the array allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return chunks.get_allocator().resource(); }
+	private:
+		// Chunks are cache line aligned, so chunks of cache line sized elements never straddle lines
+		static constexpr std::size_t chunk_alignment = std::max<std::size_t>(alignof(T), 64);
+
+		void add_chunk() {
+			std::pmr::memory_resource* memory = resource();
+			T* added = static_cast<T*>(memory->allocate(chunk_size * sizeof(T), chunk_alignment));
+			try {
+				chunks.push_back(added);
+			}
+			catch (...) {
+				memory->deallocate(added, chunk_size * sizeof(T), chunk_alignment);
+				throw;
+			}
+			Stats::on_allocate(chunk_size * sizeof(T));
+		}
+
+		// Frees the last chunk, which must hold no elements
+		void free_chunk() noexcept {
+			resource()->deallocate(chunks.back(), chunk_size * sizeof(T), chunk_alignment);
+			chunks.pop_back();
+		}
+
+		// Frees every chunk after the one holding the last element
+		void release_spare() noexcept {
+			while (chunks.size() > chunk_count())
+				free_chunk();
+		}
+
+		// Destroys the elements from index [from] onwards, a chunk at a time
+		void destroy_from(std::size_t from) noexcept {
+			if constexpr (!std::is_trivially_destructible<T>::value)
+				while (from < visible) {
+					const std::size_t offset = from & (chunk_size - 1);
+					const std::size_t count = std::min(chunk_size - offset, visible - from);
+					std::destroy_n(chunks[from >> ChunkBits] + offset, count);
+					from += count;
+				}
+		}
+
+		// Index of chunk pointers, the only part that is ever copied when the array grows
+		std::pmr::vector<T*> chunks;
+		std::size_t visible = 0;
+	};
+}
@@ -0,0 +1,378 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace pz {
+	//// Binary format
+	// A container is written as a serial_header followed by its elements in order.
+	// The format only records the elements, so any pz container can read what another wrote.
+
+	// Header written before the elements
+	struct serial_header {
+		char magic[4];
+		std::uint16_t version;
+
+		// Written as 0x0102, so data from a machine of the other byte order is rejected
+		std::uint16_t byte_order;
+		std::uint32_t element_size;
+		std::uint32_t reserved;
+		std::uint64_t count;
+	};
+
+	// Destination for bytes, written through a buffer that is handed to overflow() when it runs out
+	// Small writes are a bounds check and a memcpy, so writing element by element stays cheap.
+	struct byte_sink {
+		byte_sink() = default;
+		byte_sink(const byte_sink& other) = delete;
+		void operator=(const byte_sink& other) = delete;
+		virtual ~byte_sink() = default;
+
+		// Writes [size] bytes from [data]
+		void write(const void* data, const std::size_t size) {
+			if (size <= std::size_t(limit - pos)) {
+				if (size)
+					std::memcpy(pos, data, size);
+				pos += size;
+			}
+			else
+				overflow(data, size);
+		}
+
+		// Writes the bytes of a trivially copyable value
+		template <typename T>
+		void write_value(const T& value) { write(&value, sizeof(T)); }
+
+		// Returns room for at least [size] bytes to be written straight into, to be followed by commit()
+		// Sinks that can't make that much room throw, even if fewer bytes end up being written.
+		char* reserve(const std::size_t size) {
+			if (size > std::size_t(limit - pos))
+				make_room(size);
+			return pos;
+		}
+		void commit(char* end) noexcept { pos = end; }
+	protected:
+		// Writes [size] bytes that don't fit in the current buffer
+		virtual void overflow(const void* data, std::size_t size) = 0;
+
+		// Makes at least [size] bytes available at pos
+		virtual void make_room(std::size_t size) = 0;
+
+		// Free part of the current buffer
+		char* pos = nullptr;
+		char* limit = nullptr;
+	};
+
+	// Sink appending to a vector, which grows geometrically and is trimmed to what was written by finish() or the destructor
+	struct buffer_sink : byte_sink {
+		explicit buffer_sink(std::vector<char>& out) : out(out) {}
+		~buffer_sink() override { finish(); }
+
+		// Trims the vector to the bytes written
+		void finish() {
+			if (pos)
+				out.resize(std::size_t(pos - out.data()));
+			pos = limit = nullptr;
+		}
+	protected:
+		void overflow(const void* data, const std::size_t size) override {
+			make_room(size);
+			std::memcpy(pos, data, size);
+			pos += size;
+		}
+		void make_room(const std::size_t size) override {
+			const std::size_t used = pos ? std::size_t(pos - out.data()) : out.size();
+			out.resize(std::max({ 2 * out.size(), used + size, std::size_t(4096) }));
+			pos = out.data() + used;
+			limit = out.data() + out.size();
+		}
+	private:
+		std::vector<char>& out;
+	};
+
+	// Sink writing into a fixed buffer supplied by the caller, throwing std::length_error once it is full
+	struct span_sink : byte_sink {
+		span_sink(char* buffer, const std::size_t size) : start(buffer) {
+			pos = buffer;
+			limit = buffer + size;
+		}
+
+		// Number of bytes written
+		std::size_t size() const noexcept { return std::size_t(pos - start); }
+	protected:
+		void overflow(const void*, std::size_t) override { throw std::length_error("Buffer is full"); }
+		void make_room(std::size_t) override { throw std::length_error("Buffer is full"); }
+	private:
+		char* start;
+	};
+
+#if defined(__unix__) || defined(__APPLE__)
+	// Sink writing to a file descriptor through a 64 KiB buffer, with large writes going straight to the descriptor
+	// The destructor flushes what is left but can't report errors, so call flush() to find out.
+	struct fd_sink : byte_sink {
+		static constexpr std::size_t buffer_size = std::size_t(1) << 16;
+
+		explicit fd_sink(const int fd) : fd(fd), buffer(new char[buffer_size]) {
+			pos = buffer.get();
+			limit = pos + buffer_size;
+		}
+		~fd_sink() override {
+			try {
+				flush();
+			}
+			catch (...) {}
+		}
+
+		// Writes out everything buffered so far
+		void flush() {
+			write_all(buffer.get(), std::size_t(pos - buffer.get()));
+			pos = buffer.get();
+		}
+	protected:
+		void overflow(const void* data, const std::size_t size) override {
+			flush();
+			if (size >= buffer_size)
+				write_all(static_cast<const char*>(data), size);
+			else {
+				std::memcpy(pos, data, size);
+				pos += size;
+			}
+		}
+		void make_room(const std::size_t size) override {
+			flush();
+			if (size > buffer_size)
+				throw std::length_error("Reservation is larger than the sink's buffer");
+		}
+	private:
+		void write_all(const char* data, std::size_t size) {
+			while (size) {
+				const ssize_t written = ::write(fd, data, size);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					throw std::runtime_error("Failed writing to file descriptor");
+				data += written;
+				size -= std::size_t(written);
+			}
+		}
+		int fd;
+		std::unique_ptr<char[]> buffer;
+	};
+#endif
+
+	// Source of bytes, read through a buffer that is refilled by underflow() when it runs out
+	struct byte_source {
+		byte_source() = default;
+		byte_source(const byte_source& other) = delete;
+		void operator=(const byte_source& other) = delete;
+		virtual ~byte_source() = default;
+
+		// Reads [size] bytes into [out], throwing std::runtime_error if the data ends first
+		void read(void* out, const std::size_t size) {
+			if (size <= std::size_t(limit - pos)) {
+				if (size)
+					std::memcpy(out, pos, size);
+				pos += size;
+			}
+			else
+				underflow(out, size);
+		}
+
+		// Reads a trivially copyable value
+		template <typename T>
+		T read_value() {
+			T value;
+			read(&value, sizeof(T));
+			return value;
+		}
+	protected:
+		// Reads [size] bytes that aren't all in the current buffer
+		virtual void underflow(void* out, std::size_t size) = 0;
+
+		// Unread part of the current buffer
+		const char* pos = nullptr;
+		const char* limit = nullptr;
+	};
+
+	// Source reading from bytes in memory, e.g. what a buffer_sink wrote
+	struct buffer_source : byte_source {
+		buffer_source(const void* data, const std::size_t size) {
+			pos = static_cast<const char*>(data);
+			limit = pos + size;
+		}
+		explicit buffer_source(const std::vector<char>& data) : buffer_source(data.data(), data.size()) {}
+	protected:
+		void underflow(void*, std::size_t) override { throw std::runtime_error("Unexpected end of serialized data"); }
+	};
+
+#if defined(__unix__) || defined(__APPLE__)
+	// Source reading from a file descriptor through a 64 KiB buffer, with large reads going straight into the destination
+	struct fd_source : byte_source {
+		static constexpr std::size_t buffer_size = std::size_t(1) << 16;
+
+		explicit fd_source(const int fd) : fd(fd), buffer(new char[buffer_size]) {}
+	protected:
+		void underflow(void* out, std::size_t size) override {
+			char* dest = static_cast<char*>(out);
+			// Use up what is buffered first
+			const std::size_t buffered = std::size_t(limit - pos);
+			if (buffered)
+				std::memcpy(dest, pos, buffered);
+			dest += buffered;
+			size -= buffered;
+			pos = limit;
+
+			if (size >= buffer_size)
+				read_fully(dest, size, size);
+			else {
+				const std::size_t got = read_fully(buffer.get(), size, buffer_size);
+				std::memcpy(dest, buffer.get(), size);
+				pos = buffer.get() + size;
+				limit = buffer.get() + got;
+			}
+		}
+	private:
+		// Reads between [least] and [most] bytes into [out], returning how many were read
+		std::size_t read_fully(char* out, const std::size_t least, const std::size_t most) {
+			std::size_t got = 0;
+			while (got < least) {
+				const ssize_t read = ::read(fd, out + got, most - got);
+				if (read < 0 && errno == EINTR)
+					continue;
+				if (read < 0)
+					throw std::runtime_error("Failed reading from file descriptor");
+				if (read == 0)
+					throw std::runtime_error("Unexpected end of serialized data");
+				got += std::size_t(read);
+			}
+			return got;
+		}
+		int fd;
+		std::unique_ptr<char[]> buffer;
+	};
+#endif
+
+	//// Elements
+
+	// How a single element is written and read
+	// Trivially copyable types are written as their bytes, so contiguous runs of them are written with one copy.
+	// Specialise this for other types, with the same members.
+	template <typename T, typename Enable = void>
+	struct serial_traits {
+		static_assert(std::is_trivially_copyable<T>::value, "No binary format for this type, specialise pz::serial_traits");
+
+		// Whether runs of elements can be copied as one block of bytes
+		static constexpr bool bulk = true;
+
+		static void write(byte_sink& sink, const T& value) { sink.write_value(value); }
+		static T read(byte_source& source) { return source.read_value<T>(); }
+	};
+
+	// Strings are written as their length followed by their characters
+	template <typename Char, typename CharTraits, typename Alloc>
+	struct serial_traits<std::basic_string<Char, CharTraits, Alloc>> {
+		static constexpr bool bulk = false;
+
+		static void write(byte_sink& sink, const std::basic_string<Char, CharTraits, Alloc>& value) {
+			sink.write_value(std::uint64_t(value.size()));
+			sink.write(value.data(), value.size() * sizeof(Char));
+		}
+		static std::basic_string<Char, CharTraits, Alloc> read(byte_source& source) {
+			std::basic_string<Char, CharTraits, Alloc> value(std::size_t(source.read_value<std::uint64_t>()), Char());
+			source.read(&value[0], value.size() * sizeof(Char));
+			return value;
+		}
+	};
+
+	// Writes the header for [count] elements of type T
+	template <typename T>
+	void write_serial_header(byte_sink& sink, const std::size_t count) {
+		serial_header header{};
+		std::memcpy(header.magic, "PZSD", 4);
+		header.version = 1;
+		header.byte_order = 0x0102;
+		header.element_size = sizeof(T);
+		header.count = count;
+		sink.write_value(header);
+	}
+
+	// Reads and checks a header written for elements of type T, returning the element count
+	// Throws std::runtime_error if the header is malformed or counts more elements than memory could hold.
+	template <typename T>
+	std::size_t read_serial_header(byte_source& source) {
+		const auto header = source.read_value<serial_header>();
+		if (std::memcmp(header.magic, "PZSD", 4) || header.version != 1)
+			throw std::runtime_error("Not serialized pz data, or from a newer version");
+		if (header.byte_order != 0x0102 || header.element_size != sizeof(T))
+			throw std::runtime_error("Serialized data holds a different element type or byte order");
+		// The count sizes allocations before any element is read, so one that couldn't be stored is rejected here
+		if (header.count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::runtime_error("Serialized element count is too large");
+		return std::size_t(header.count);
+	}
+
+	// Writes [count] contiguous elements, as one block when the type allows
+	template <typename T>
+	void write_elements(byte_sink& sink, const T* elements, const std::size_t count) {
+		if constexpr (serial_traits<T>::bulk)
+			sink.write(elements, count * sizeof(T));
+		else
+			for (std::size_t i = 0; i < count; ++i)
+				serial_traits<T>::write(sink, elements[i]);
+	}
+
+	//// Text
+
+	// Writes [value] as text the way an std::ostream with default flags would, formatting numbers with std::to_chars
+	// straight into the sink's buffer: bool as 1 or 0, character types as the character, and floating point with
+	// 6 significant digits like printf's %g.
+	template <typename T>
+	void write_text_value(byte_sink& sink, const T& value) {
+		if constexpr (std::is_same<T, bool>::value)
+			sink.write(value ? "1" : "0", 1);
+		else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value)
+			sink.write(&value, 1);
+		else if constexpr (std::is_arithmetic<T>::value) {
+			// Enough for any integer, and for any floating point value to 6 significant digits
+			// Formatted on the stack and then written, so a sink only needs room for the digits actually produced.
+			constexpr std::size_t longest = 32;
+			char text[longest];
+			char* end;
+			if constexpr (std::is_floating_point<T>::value)
+				end = std::to_chars(text, text + longest, value, std::chars_format::general, 6).ptr;
+			else
+				end = std::to_chars(text, text + longest, value).ptr;
+			sink.write(text, std::size_t(end - text));
+		}
+		else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+			const std::string_view text(value);
+			sink.write(text.data(), text.size());
+		}
+		else
+			static_assert(std::is_arithmetic<T>::value, "Only numbers and strings can be written as text");
+	}
+
+	// Writes the values from [first] to [last] as text in the form [a, b, c], the same as operator<<
+	template <typename Iter>
+	void write_text_list(byte_sink& sink, Iter first, const Iter last) {
+		sink.write("[", 1);
+		for (bool start = true; first != last; ++first, start = false) {
+			if (!start)
+				sink.write(", ", 2);
+			write_text_value(sink, *first);
+		}
+		sink.write("]", 1);
+	}
+}
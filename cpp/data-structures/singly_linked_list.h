@@ -1,8 +1,15 @@
 #pragma once
 #include <stdexcept>
 #include <vector>
-template <typename T>
-class slist {
+#include <ostream>
+#include "container_stats.h"
+#include "memory_resource.h"
+#include "serialization.h"
+// Singly linked list
+// Nodes come from a std::pmr::memory_resource, the default resource unless one is given.
+// [Stats] is the statistics policy, see container_stats.h.
+template <typename T, typename Stats = pz::no_stats>
+class slist : protected Stats {
 protected:
 	struct node {
 		node(T value) : val(value) {};
@@ -64,6 +71,11 @@ public:
 		node* ptr;
 	};
 public:
+	slist() = default;
+
+	// Creates an empty list that allocates its nodes from [resource]
+	explicit slist(std::pmr::memory_resource* resource) : memory(resource) {}
+
 	// Adds an element onto the end of the list. 
 	// Takes O(n) time.
 	void append(T element) noexcept {
@@ -75,9 +87,11 @@ public:
 		// Iterate until there is no node
 		while (*iter)
 			iter = &((*iter)->next);
+		Stats::on_traverse(count);
 
 		// Assign a new node with the element's value
-		*iter = new node(element);
+		*iter = pz::make_node<node>(memory, element);
+		Stats::on_allocate(sizeof(node));
 		++count;
 	}
 
@@ -87,18 +101,21 @@ public:
 		// Get address of the address of the first node
 		node** iter = &first;
 		node* prev = nullptr;
+		std::size_t steps = 0;
 		// While there are still nodes to traverse and the element hasn't been found
 		while (*iter && (*iter)->val != element) {
 			prev = *iter;
 			// Move onto the next node
 			iter = &((*iter)->next);
+			++steps;
 		}
+		Stats::on_traverse(steps);
 		auto current = *iter;
 		// Replace the node with the one it has its next
 		*iter = (*iter)->next;
 
 		// Deallocate memory used for the deleted node 
-		delete current;
+		pz::destroy_node(memory, current);
 		--count;
 		
 	}
@@ -127,7 +144,7 @@ public:
 
 	// Output the list to an output stream.
 	// Takes O(n) time.
-	friend std::ostream& operator<< (std::ostream& os, const slist<T>& list) {
+	friend std::ostream& operator<< (std::ostream& os, const slist& list) {
 		os << '[';
 		node *iter = list.first;
 		if (!list.empty()) {
@@ -140,6 +157,35 @@ public:
 		os << ']';
 		return os;
 	}
+	// Writes the list in the binary format from serialization.h, front to back
+	// Takes O(n) time.
+	void serialize(pz::byte_sink& sink) const {
+		pz::write_serial_header<T>(sink, count);
+		for (node* iter = first; iter; iter = iter->next)
+			pz::serial_traits<T>::write(sink, iter->val);
+	}
+
+	// Replaces the contents of the list with what serialize(), or any other pz container holding the same type, wrote
+	// Lists can't be moved, so unlike the array containers this fills an existing list rather than returning one.
+	// Takes O(n) time.
+	void deserialize(pz::byte_source& source) {
+		clear();
+		const std::size_t size = pz::read_serial_header<T>(source);
+
+		// Link each node onto the end as it is read, rather than walking the list like append
+		node** tail = &first;
+		for (std::size_t i = 0; i < size; ++i) {
+			*tail = pz::make_node<node>(memory, pz::serial_traits<T>::read(source));
+			Stats::on_allocate(sizeof(node));
+			tail = &((*tail)->next);
+			++count;
+		}
+	}
+
+	// Writes the list as text in the same form as operator<<, without going through iostreams
+	// Takes O(n) time.
+	void write_text(pz::byte_sink& sink) const { pz::write_text_list(sink, const_iterator(first), const_iterator(nullptr)); }
+
 	// Return the number of elements in the list.
 	// Takes O(n) time.
 	size_t size() const noexcept { return count;}
@@ -157,6 +203,14 @@ public:
 		return vec;
 	}
 
+	// Returns what the statistics policy has recorded.
+	// Takes O(1) time.
+	pz::container_stats stats() const noexcept { return Stats::snapshot(); }
+
+	// Returns the memory resource the list allocates from.
+	// Takes O(1) time.
+	std::pmr::memory_resource* resource() const noexcept { return memory; }
+
 	// Remove all elements from the list
 	// Takes O(n) time.
 	void clear() {
@@ -165,7 +219,7 @@ public:
 		while (iter) {
 			prev = iter;
 			iter = iter->next;
-			delete prev;
+			pz::destroy_node(memory, prev);
 		}
 		first = nullptr;
 		count = 0;
@@ -179,15 +233,19 @@ protected:
 	node** find_node(T element) { 
 		// Get address of the address of the first node
 		node** iter = &first;
+		std::size_t steps = 0;
 
 		// While it isn't nullptr or the sought out variable.
 		while (*iter && (*iter) -> val != element) {
 			// Move onto the next node
 			iter = &((*iter)->next);
+			++steps;
 		}
+		Stats::on_traverse(steps);
 		return iter;
 	}
 protected:
+	std::pmr::memory_resource* memory = std::pmr::get_default_resource();
 	size_t count = 0;
 	node *first = nullptr;
 };
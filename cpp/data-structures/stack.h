@@ -1,10 +1,17 @@
 #pragma once
 #include <utility>
 #include <iterator>
+#include <vector>
+#include "container_stats.h"
+#include "memory_resource.h"
+#include "serialization.h"
 using std::move;
 namespace pz {
-	template <typename T>
-	struct stack {
+	// Linked stack
+	// Nodes come from a std::pmr::memory_resource, the default resource unless one is given.
+	// [Stats] is the statistics policy, see container_stats.h.
+	template <typename T, typename Stats = no_stats>
+	struct stack : protected Stats {
 	protected:
 		// Stack node
 		struct node {
@@ -42,21 +49,26 @@ namespace pz {
 		// Default constructor
 		stack() = default;
 
+		// Creates an empty stack that allocates its nodes from [resource]
+		explicit stack(std::pmr::memory_resource* resource) : memory(resource) {}
+
 		// Copy constructor
-		stack(const stack<T>& other) {
+		// Like the std::pmr containers, the copy uses [resource] rather than the other stack's resource.
+		stack(const stack& other, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : memory(resource), count(other.count) {
 			node* otherNodes = other.top;
 			node** newNodes = &top;
 			// Go down from top to bottom allocating nodes for the stack being constructed,
 			// copying the value from the original stack to the new stack
 			while (otherNodes) {
-				*newNodes = new node{ otherNodes->value };
+				*newNodes = make_node<node>(memory, otherNodes->value);
+				Stats::on_allocate(sizeof(node));
 				otherNodes = otherNodes->next;
 				newNodes = &((*newNodes)->next);
 			}
 		}
 		
 		// Move constructor
-		stack(stack<T>&& other) noexcept {
+		stack(stack&& other) noexcept : Stats(std::move(other)), memory(other.memory) {
 			// Exchange values
 			top = other.top;
 			other.top = nullptr;
@@ -67,7 +79,8 @@ namespace pz {
 			node* next = top;
 
 			// Set the top to the new element
-			top = new node{ element };
+			top = make_node<node>(memory, element);
+			Stats::on_allocate(sizeof(node));
 
 			// Make the top node point to the former top node
 			top->next = next;
@@ -75,7 +88,8 @@ namespace pz {
 		}
 		void push(T&& element) {
 			node* next = top;
-			top = new node{ move(element) };
+			top = make_node<node>(memory, move(element));
+			Stats::on_allocate(sizeof(node));
 			top->next = next;
 			++count;
 		}
@@ -88,7 +102,7 @@ namespace pz {
 			top = top->next;
 			
 			// Deallocate the previous top node
-			delete old_top;
+			destroy_node(memory, old_top);
 			--count;
 			return val;
 		}
@@ -96,6 +110,41 @@ namespace pz {
 		bool empty() const noexcept { return !top; }
 		const_iterator cbegin() const { return const_iterator(top); }
 		const_iterator cend() const { return const_iterator(nullptr); }
+
+		// Writes the stack in the binary format from serialization.h, bottom to top so reading it back is a series of pushes
+		// The same order as vector_stack, so either can read what the other wrote.
+		// Takes O(n) time.
+		void serialize(byte_sink& sink) const {
+			write_serial_header<T>(sink, count);
+			std::vector<const node*> nodes;
+			nodes.reserve(count);
+			for (const node* it = top; it; it = it->next)
+				nodes.push_back(it);
+			for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+				serial_traits<T>::write(sink, (*it)->value);
+		}
+
+		// Reads a stack written by serialize(), or by any other pz container holding the same type
+		// Takes O(n) time.
+		static stack deserialize(byte_source& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			const std::size_t size = read_serial_header<T>(source);
+			stack out(resource);
+			for (std::size_t i = 0; i < size; ++i)
+				out.push(serial_traits<T>::read(source));
+			return out;
+		}
+
+		// Writes the stack as text in the form [top, ..., bottom]
+		// Takes O(n) time.
+		void write_text(byte_sink& sink) const { write_text_list(sink, cbegin(), cend()); }
+
+		// Returns what the statistics policy has recorded.
+		// Takes O(1) time.
+		container_stats stats() const noexcept { return Stats::snapshot(); }
+
+		// Returns the memory resource the stack allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return memory; }
 		~stack() {
 			node* it = top;
 			node* temp = nullptr;
@@ -103,10 +152,11 @@ namespace pz {
 			while (it) {
 				temp = it;
 				it = it->next;
-				delete temp;
+				destroy_node(memory, temp);
 			}
 		}
 	protected:
+		std::pmr::memory_resource* memory = std::pmr::get_default_resource();
 		node* top = nullptr;
 		size_t count = 0;
 	};
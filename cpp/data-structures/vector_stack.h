@@ -1,11 +1,31 @@
 #pragma once
 #include <utility>
 #include <vector>
+#include <memory_resource>
+#include <ostream>
+#include "container_stats.h"
+#include "serialization.h"
 namespace pz {
-	template <typename T>
-	struct vector_stack {
-		void push(const T& element){ vec.push_back(element); }
-		void push(T&& element) { vec.push_back(std::forward<T>(element)); }
+	// Stack backed by a vector
+	// The vector allocates from a std::pmr::memory_resource, the default resource unless one is given.
+	// [Stats] is the statistics policy, see container_stats.h.
+	template <typename T, typename Stats = no_stats>
+	struct vector_stack : protected Stats {
+		vector_stack() = default;
+
+		// Creates an empty stack whose vector allocates from [resource]
+		explicit vector_stack(std::pmr::memory_resource* resource) : vec(resource) {}
+
+		void push(const T& element){
+			const auto old_capacity = vec.capacity();
+			vec.push_back(element);
+			on_push(old_capacity);
+		}
+		void push(T&& element) {
+			const auto old_capacity = vec.capacity();
+			vec.push_back(std::forward<T>(element));
+			on_push(old_capacity);
+		}
 		T pop() {
 			auto temp = vec[vec.size() - 1];
 			vec.pop_back();
@@ -27,7 +47,52 @@ namespace pz {
 			return os;
 		}
 		auto size() const { return vec.size(); }
+
+		// Writes the stack in the binary format from serialization.h, bottom to top so reading it back is a series of pushes
+		// Trivially copyable elements are written with one copy.
+		// Takes O(n) time.
+		void serialize(byte_sink& sink) const {
+			write_serial_header<T>(sink, vec.size());
+			write_elements(sink, vec.data(), vec.size());
+		}
+
+		// Reads a stack written by serialize(), or by any other pz container holding the same type
+		// Takes O(n) time.
+		static vector_stack deserialize(byte_source& source, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+			const std::size_t size = read_serial_header<T>(source);
+			vector_stack out(resource);
+			if constexpr (serial_traits<T>::bulk) {
+				out.vec.resize(size);
+				source.read(out.vec.data(), size * sizeof(T));
+			}
+			else {
+				out.vec.reserve(size);
+				for (std::size_t i = 0; i < size; ++i)
+					out.vec.push_back(serial_traits<T>::read(source));
+			}
+			out.Stats::on_allocate(out.vec.capacity() * sizeof(T));
+			return out;
+		}
+
+		// Writes the stack as text in the same form as operator<<, top first, without going through iostreams
+		// Takes O(n) time.
+		void write_text(byte_sink& sink) const { write_text_list(sink, vec.rbegin(), vec.rend()); }
+
+		// Returns what the statistics policy has recorded.
+		// Takes O(1) time.
+		container_stats stats() const noexcept { return Stats::snapshot(); }
+
+		// Returns the memory resource the stack allocates from.
+		// Takes O(1) time.
+		std::pmr::memory_resource* resource() const noexcept { return vec.get_allocator().resource(); }
 	protected:
-		std::vector<T> vec;
+		// Records the vector growing, which moves every element but the one just pushed
+		void on_push(const std::size_t old_capacity) {
+			if (vec.capacity() != old_capacity) {
+				Stats::on_allocate(vec.capacity() * sizeof(T));
+				Stats::on_move((vec.size() - 1) * sizeof(T));
+			}
+		}
+		std::pmr::vector<T> vec;
 	};
 }
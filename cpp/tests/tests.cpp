@@ -0,0 +1,679 @@
+// Differential tests of the pz containers and algorithms against their std:: equivalents, plus one regression case per fixed bug
+// Runs every test and exits with the number of failed checks, so a failure shows up in ctest.
+#include "algorithms/external_sort.h"
+#include "algorithms/sort.h"
+#include "data-structures/array_view.h"
+#include "data-structures/b_plus_tree.h"
+#include "data-structures/binary_search_tree.h"
+#include "data-structures/concurrent_search_tree.h"
+#include "data-structures/d_ary_heap.h"
+#include "data-structures/dynamic_array.h"
+#include "data-structures/frozen_search_tree.h"
+#include "data-structures/heap_array.h"
+#include "data-structures/segmented_array.h"
+#include "data-structures/serialization.h"
+#include "data-structures/singly_linked_list.h"
+#include "data-structures/vector_stack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	int failures = 0;
+
+	void report(const bool ok, const char* expression, const char* file, const int line) {
+		if (!ok) {
+			++failures;
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+		}
+	}
+
+	// Records a failure and carries on, so one run reports every broken check
+#define CHECK(expression) report(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+	// Checks that [body] throws an exception of type E
+	template <typename E, typename Body>
+	bool throws(Body body) {
+		try {
+			body();
+		}
+		catch (const E&) {
+			return true;
+		}
+		catch (...) {
+			return false;
+		}
+		return false;
+	}
+
+	//// Inputs
+
+	std::mt19937_64 gen(20261018);
+
+	// Adversarial orders that the sorts and selections treat specially, as well as plain random keys
+	const char* const shapes[] = { "random", "sorted", "reversed", "equal", "few_unique", "organ_pipe", "sawtooth" };
+	const std::size_t sizes[] = { 0, 1, 2, 3, 15, 16, 17, 100, 1000, 20000 };
+
+	template <typename T>
+	std::vector<T> make_input(const std::string& shape, const std::size_t n) {
+		std::vector<T> values(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			const auto bits = gen();
+			if constexpr (std::is_floating_point<T>::value)
+				values[i] = T(std::int64_t(bits % 2000001) - 1000000) / T(7);
+			else
+				values[i] = static_cast<T>(bits);
+		}
+		if (shape == "sorted")
+			std::sort(values.begin(), values.end());
+		else if (shape == "reversed")
+			std::sort(values.begin(), values.end(), std::greater<>());
+		else if (shape == "equal")
+			std::fill(values.begin(), values.end(), n ? values[0] : T());
+		else if (shape == "few_unique")
+			for (auto& value : values)
+				value = static_cast<T>(gen() % 4);
+		else if (shape == "organ_pipe")
+			for (std::size_t i = 0; i < n; ++i)
+				values[i] = static_cast<T>(std::min(i, n - i));
+		else if (shape == "sawtooth")
+			for (std::size_t i = 0; i < n; ++i)
+				values[i] = static_cast<T>(i % 37);
+		return values;
+	}
+
+	std::vector<std::string> make_strings(const std::size_t n, const std::size_t max_length, const int alphabet, const std::string& prefix = "") {
+		std::vector<std::string> strings(n);
+		for (auto& str : strings) {
+			str = prefix;
+			for (std::size_t i = gen() % (max_length + 1); i > 0; --i)
+				str += char('a' + gen() % alphabet);
+		}
+		return strings;
+	}
+
+	template <typename C>
+	std::string text_of(const C& container) {
+		std::vector<char> bytes;
+		{
+			pz::buffer_sink out(bytes);
+			container.write_text(out);
+		}
+		return std::string(bytes.begin(), bytes.end());
+	}
+
+	template <typename C>
+	std::string stream_of(const C& container) {
+		std::ostringstream out;
+		out << container;
+		return out.str();
+	}
+
+	// Header claiming [count] elements of type T followed by a single element
+	template <typename T>
+	std::vector<char> bogus_header(const std::uint64_t count) {
+		std::vector<char> bytes;
+		pz::buffer_sink out(bytes);
+		pz::write_serial_header<T>(out, 0);
+		out.finish();
+		std::memcpy(bytes.data() + offsetof(pz::serial_header, count), &count, sizeof(count));
+		bytes.resize(bytes.size() + sizeof(T));
+		return bytes;
+	}
+
+	//// Sorting
+
+	template <typename T>
+	void test_sorts_of() {
+		for (const char* shape : shapes) {
+			for (const std::size_t n : sizes) {
+				const auto input = make_input<T>(shape, n);
+				auto expected = input;
+				std::sort(expected.begin(), expected.end());
+
+				auto values = input;
+				intro_sort(values.begin(), values.end());
+				CHECK(values == expected);
+
+				values = input;
+				radix_sort(values);
+				CHECK(values == expected);
+
+				values = input;
+				parallel_radix_sort(values, 4);
+				CHECK(values == expected);
+
+				values = input;
+				heap_sort(values.begin(), values.end(), std::less<>());
+				CHECK(values == expected);
+
+				if (n <= 1000) {
+					values = input;
+					insertion_sort(values.begin(), values.end(), std::less<>());
+					CHECK(values == expected);
+				}
+
+				// Descending goes through the comparison-based paths rather than the sorting network
+				values = input;
+				intro_sort(values.begin(), values.end(), std::greater<>());
+				CHECK(std::equal(values.begin(), values.end(), expected.rbegin()));
+
+				// The permutation must be stable, like std::stable_sort
+				std::vector<std::size_t> stable(n);
+				std::iota(stable.begin(), stable.end(), std::size_t(0));
+				std::stable_sort(stable.begin(), stable.end(), [&input](std::size_t a, std::size_t b) { return input[a] < input[b]; });
+				CHECK(radix_sort_permutation(input) == stable);
+			}
+		}
+	}
+
+	void test_sorts() {
+		test_sorts_of<unsigned int>();
+		test_sorts_of<int>();
+		test_sorts_of<std::int64_t>();
+		test_sorts_of<float>();
+		test_sorts_of<double>();
+
+		// Sorting by a key function, here the low byte, must keep equal keys in their original order
+		struct item {
+			unsigned int key, order;
+		};
+		std::vector<item> items(5000);
+		for (unsigned int i = 0; i < items.size(); ++i)
+			items[i] = { unsigned(gen() % 256), i };
+		auto expected = items;
+		std::stable_sort(expected.begin(), expected.end(), [](const item& a, const item& b) { return a.key < b.key; });
+		radix_sort(items, [](const item& it) { return it.key; });
+		CHECK(std::equal(items.begin(), items.end(), expected.begin(), [](const item& a, const item& b) { return a.order == b.order; }));
+
+		// Regression (user-004): the sorting network wrote one of two equivalent values into both slots, losing -0.0
+		for (const std::size_t n : { 2, 5, 16, 40 }) {
+			std::vector<double> zeros(n);
+			for (std::size_t i = 0; i < n; ++i)
+				zeros[i] = (i % 2) ? -0.0 : (i % 5 == 4 ? 1.0 : 0.0);
+			auto sorted = zeros;
+			intro_sort(sorted.begin(), sorted.end());
+			CHECK(std::is_sorted(sorted.begin(), sorted.end()));
+			CHECK(std::count_if(sorted.begin(), sorted.end(), [](double x) { return std::signbit(x); }) == std::ptrdiff_t(n / 2));
+		}
+		std::vector<float> pair = { -0.0f, 0.0f };
+		intro_sort(pair.begin(), pair.end());
+		CHECK(std::signbit(pair[0]) != std::signbit(pair[1]));
+
+		// Strings go through the comparison sort too
+		auto strings = make_strings(5000, 12, 3);
+		auto sorted_strings = strings;
+		std::sort(sorted_strings.begin(), sorted_strings.end());
+		intro_sort(strings.begin(), strings.end());
+		CHECK(strings == sorted_strings);
+	}
+
+	void test_string_sort() {
+		for (const int alphabet : { 1, 2, 4, 26 })
+			for (const std::size_t n : { 0, 1, 10, 500, 5000, 30000 }) {
+				auto strings = make_strings(n, 20, alphabet);
+				auto expected = strings;
+				std::sort(expected.begin(), expected.end());
+				string_sort(strings);
+				CHECK(strings == expected);
+			}
+
+		// Characters compare as unsigned, so bytes above 127 sort after ASCII
+		std::vector<std::string> bytes = { "\xff", "a", "\x80z", "", "\x80" };
+		auto expected = bytes;
+		std::sort(expected.begin(), expected.end());
+		string_sort(bytes);
+		CHECK(bytes == expected);
+
+		std::vector<std::string> empty(3000);
+		string_sort(empty);
+		CHECK(std::all_of(empty.begin(), empty.end(), [](const std::string& str) { return str.empty(); }));
+
+		// Regression (user-006): a long prefix shared by every string recursed once per character in American flag sort
+		auto shared = make_strings(5000, 6, 10, std::string(20000, 'p'));
+		expected = shared;
+		std::sort(expected.begin(), expected.end());
+		string_sort(shared);
+		CHECK(shared == expected);
+
+		// Regression (user-006): buckets below the American flag threshold recursed once per shared character in multikey quicksort
+		auto deep = make_strings(1000, 6, 10, std::string(200000, 'p'));
+		expected = deep;
+		std::sort(expected.begin(), expected.end());
+		string_sort(deep);
+		CHECK(deep == expected);
+	}
+
+	void test_external_sort() {
+		namespace fs = std::filesystem;
+		const fs::path dir = fs::temp_directory_path() / ("pz_tests_" + std::to_string(std::random_device{}()));
+		fs::create_directories(dir);
+		const std::string input = (dir / "input").string(), output = (dir / "output").string();
+
+		for (const std::size_t n : { 0, 1000, 200000 }) {
+			auto values = make_input<std::uint64_t>("random", n);
+			external_file(input, "wb").write(values.data(), values.size());
+
+			// A small memory limit spills many runs, a large one sorts in memory
+			for (const std::size_t limit : { std::size_t(1) << 14, std::size_t(1) << 24 }) {
+				external_sort_options options;
+				options.memory_limit = limit;
+				options.temp_dir = dir.string();
+				external_sort<std::uint64_t>(input, output, options);
+
+				std::vector<std::uint64_t> sorted(n + 1);
+				sorted.resize(external_file(output, "rb").read(sorted.data(), sorted.size()));
+				auto expected = values;
+				std::sort(expected.begin(), expected.end());
+				CHECK(sorted == expected);
+			}
+		}
+		// Regression (user-005): every run was merged at once, so over a thousand runs ran out of file descriptors
+		// and a small budget left each run a buffer of a record or two. 1100 runs now merge in groups of at most max_fan_in.
+		{
+			auto values = make_input<std::uint64_t>("random", 1100 * 256);
+			external_file(input, "wb").write(values.data(), values.size());
+			external_sort_options options;
+			options.memory_limit = 4096;
+			options.min_buffer_bytes = 8;
+			options.temp_dir = dir.string();
+			external_sort<std::uint64_t>(input, output, options);
+
+			std::vector<std::uint64_t> sorted(values.size() + 1);
+			sorted.resize(external_file(output, "rb").read(sorted.data(), sorted.size()));
+			std::sort(values.begin(), values.end());
+			CHECK(sorted == values);
+		}
+
+		// Every run file is removed once the sort is done
+		CHECK(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 2);
+		fs::remove_all(dir);
+	}
+
+	//// Selection
+
+	void test_selection() {
+		for (const char* shape : shapes) {
+			for (const std::size_t n : sizes) {
+				if (!n)
+					continue;
+				const auto input = make_input<int>(shape, n);
+				auto sorted = input;
+				std::sort(sorted.begin(), sorted.end());
+
+				for (const std::size_t k : { std::size_t(0), n / 3, n / 2, n - 1 }) {
+					CHECK(radix_select(input, k) == sorted[k]);
+
+					auto values = input;
+					select_nth(values.begin(), values.begin() + std::ptrdiff_t(k), values.end());
+					CHECK(values[k] == sorted[k]);
+					CHECK(std::all_of(values.begin(), values.begin() + std::ptrdiff_t(k), [&](int v) { return v <= sorted[k]; }));
+					CHECK(std::all_of(values.begin() + std::ptrdiff_t(k), values.end(), [&](int v) { return v >= sorted[k]; }));
+
+					values = input;
+					partial_sort_top_k(values.begin(), values.end(), k);
+					CHECK(std::equal(values.begin(), values.begin() + std::ptrdiff_t(k), sorted.begin()));
+				}
+
+				streaming_top_k<int> top(10);
+				for (const int value : input)
+					top.push(value);
+				const auto kept = top.to_vector();
+				CHECK(std::equal(kept.begin(), kept.end(), sorted.begin()) && kept.size() == std::min<std::size_t>(10, n));
+			}
+		}
+		CHECK(throws<std::out_of_range>([] { radix_select(std::vector<int>{ 1, 2 }, 2); }));
+
+		// Regression (user-007): percentile followed the nearest-rank rule its doc describes
+		const std::vector<int> values = { 15, 20, 35, 40, 50 };
+		CHECK(percentile(values, 5) == 15);
+		CHECK(percentile(values, 30) == 20);
+		CHECK(percentile(values, 40) == 20);
+		CHECK(percentile(values, 50) == 35);
+		CHECK(percentile(values, 100) == 50);
+		CHECK(percentile(values, 0) == 15);
+		const std::vector<int> ten = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+		CHECK(percentile(ten, 90) == 9);
+		CHECK(percentile(ten, 91) == 10);
+		CHECK(throws<std::out_of_range>([] { percentile(std::vector<int>{}, 50); }));
+	}
+
+	//// Trees
+
+	// Applies the same random adds and removes to [tree] and a std::multiset and compares them after every batch
+	template <typename Tree>
+	void check_against_multiset(Tree& tree, const std::size_t operations, const unsigned int range) {
+		std::multiset<unsigned int> expected;
+		for (std::size_t i = 0; i < operations; ++i) {
+			const auto value = unsigned(gen() % range);
+			if (gen() % 3) {
+				tree.add(value);
+				expected.insert(value);
+			}
+			else {
+				tree.remove(value);
+				if (const auto found = expected.find(value); found != expected.end())
+					expected.erase(found);
+			}
+			if (i % 1000 == 0 || i + 1 == operations) {
+				CHECK(tree.size() == expected.size());
+				const auto values = tree.to_vector();
+				CHECK(std::equal(values.begin(), values.end(), expected.begin(), expected.end()));
+			}
+		}
+	}
+
+	void test_trees() {
+		{
+			bst<unsigned int> tree;
+			check_against_multiset(tree, 20000, 500);
+			for (unsigned int value = 0; value < 500; ++value)
+				CHECK((tree.find(value) != nullptr) == (std::count(tree.begin(), tree.end(), value) > 0));
+		}
+		{
+			bst<unsigned int, pz::counting_stats> tree;
+			tree.self_balance(0.7);
+			check_against_multiset(tree, 20000, 100000);
+			// The scapegoat bound keeps the height within log base 1/0.7 of the largest size
+			CHECK(tree.stats().height <= std::size_t(std::log(20000.0) / std::log(1 / 0.7)) + 2);
+			CHECK(throws<std::invalid_argument>([&] { tree.self_balance(0.3); }));
+		}
+		{
+			bst<unsigned int, pz::no_stats, true> tree;
+			std::vector<unsigned int> values;
+			for (int i = 0; i < 3000; ++i) {
+				values.push_back(unsigned(gen() % 1000));
+				tree.add(values.back());
+			}
+			std::sort(values.begin(), values.end());
+			for (unsigned int probe = 0; probe <= 1000; probe += 7) {
+				const auto rank = std::size_t(std::lower_bound(values.begin(), values.end(), probe) - values.begin());
+				CHECK(tree.rank(probe) == rank);
+				CHECK((tree.lower_bound(probe) == tree.end()) == (rank == values.size()));
+				CHECK(tree.count_range(probe, probe + 50) == std::size_t(std::lower_bound(values.begin(), values.end(), probe + 50) - values.begin()) - rank);
+			}
+			for (std::size_t k = 0; k < values.size(); k += 13)
+				CHECK(*tree.select(k) == values[k]);
+			CHECK(tree.select(values.size()) == tree.end());
+
+			const auto frozen = tree.freeze();
+			CHECK(frozen.to_vector() == values);
+		}
+		{
+			concurrent_bst<unsigned int> tree;
+			check_against_multiset(tree, 5000, 300);
+		}
+		{
+			bplus_tree<unsigned int> tree;
+			check_against_multiset(tree, 50000, 2000);
+		}
+		{
+			bplus_tree<std::uint64_t, std::string> map;
+			std::multimap<std::uint64_t, std::string> expected;
+			for (int i = 0; i < 5000; ++i) {
+				const auto key = gen() % 700;
+				map.add(key, std::to_string(key * 3));
+				expected.emplace(key, std::to_string(key * 3));
+			}
+			for (std::uint64_t key = 0; key < 700; ++key) {
+				const auto found = map.find(key);
+				CHECK((found != nullptr) == (expected.count(key) > 0));
+				if (found)
+					CHECK(*found == std::to_string(key * 3));
+			}
+		}
+	}
+
+	void test_frozen_search_tree() {
+		for (const std::size_t n : { 0, 1, 2, 15, 16, 17, 1000, 65537 }) {
+			auto values = make_input<int>("random", n);
+			std::sort(values.begin(), values.end());
+			const frozen_bst<int> tree(values);
+			CHECK(tree.size() == n && tree.to_vector() == values);
+
+			std::vector<int> probes(500);
+			for (auto& probe : probes)
+				probe = (n && gen() % 2) ? values[gen() % n] : int(gen());
+			std::vector<const int*> found(probes.size()), lower(probes.size());
+			tree.find_many(probes.data(), probes.size(), found.data());
+			tree.lower_bound_many(probes.data(), probes.size(), lower.data());
+			for (std::size_t i = 0; i < probes.size(); ++i) {
+				const auto expected = std::lower_bound(values.begin(), values.end(), probes[i]);
+				const int* single = tree.lower_bound(probes[i]);
+				CHECK((expected == values.end()) ? !single : (single && *single == *expected));
+				CHECK(lower[i] == single);
+				CHECK(found[i] == tree.find(probes[i]));
+				CHECK((found[i] != nullptr) == std::binary_search(values.begin(), values.end(), probes[i]));
+			}
+		}
+	}
+
+	//// Heaps
+
+	template <std::size_t Arity>
+	void test_d_ary_heap_of() {
+		pz::d_ary_heap<int, Arity> heap;
+		std::multiset<int> expected;
+		std::vector<std::pair<std::size_t, int>> live;
+		for (int i = 0; i < 30000; ++i) {
+			const auto op = gen() % 10;
+			if (op < 4 || expected.empty()) {
+				const int value = int(gen() % 1000);
+				live.push_back({ heap.push(value), value });
+				expected.insert(value);
+			}
+			else if (op < 6) {
+				CHECK(heap.top() == *expected.begin());
+				const auto id = heap.top_handle();
+				CHECK(heap.pop() == *expected.begin());
+				expected.erase(expected.begin());
+				CHECK(!heap.contains(id));
+				live.erase(std::find_if(live.begin(), live.end(), [id](const auto& entry) { return entry.first == id; }));
+			}
+			else {
+				auto& entry = live[gen() % live.size()];
+				CHECK(heap.value(entry.first) == entry.second);
+				expected.erase(expected.find(entry.second));
+				if (op < 8) {
+					entry.second -= int(gen() % 50);
+					heap.decrease_key(entry.first, entry.second);
+				}
+				else if (op < 9) {
+					entry.second = int(gen() % 1000);
+					heap.update(entry.first, entry.second);
+				}
+				else {
+					heap.erase(entry.first);
+					entry = live.back();
+					live.pop_back();
+					continue;
+				}
+				expected.insert(entry.second);
+			}
+			CHECK(heap.size() == expected.size());
+		}
+		for (auto value : expected)
+			CHECK(heap.pop() == value);
+		CHECK(heap.empty());
+	}
+
+	void test_heaps() {
+		test_d_ary_heap_of<2>();
+		test_d_ary_heap_of<3>();
+		test_d_ary_heap_of<4>();
+		test_d_ary_heap_of<8>();
+
+		const std::vector<int> values = make_input<int>("random", 5000);
+		pz::d_ary_heap<int, 4, std::greater<>> heap(values.begin(), values.end());
+		std::priority_queue<int> expected(values.begin(), values.end());
+		while (!expected.empty()) {
+			CHECK(heap.pop() == expected.top());
+			expected.pop();
+		}
+		CHECK(throws<std::out_of_range>([&] { heap.top(); }));
+		CHECK(throws<std::out_of_range>([&] { heap.erase(12345); }));
+
+		pz::d_ary_heap<int> lowered(values.begin(), values.end());
+		CHECK(throws<std::invalid_argument>([&] { lowered.decrease_key(0, values[0] + 1); }));
+
+		// Regression (user-025): pop compared against the root after moving its value out
+		struct by_pointee {
+			bool operator()(const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) const { return *a < *b; }
+		};
+		pz::d_ary_heap<std::unique_ptr<int>, 4, by_pointee> owners;
+		for (int i = 0; i < 1000; ++i)
+			owners.push(std::make_unique<int>(int(gen() % 100)));
+		int previous = -1;
+		while (!owners.empty()) {
+			const auto popped = owners.pop();
+			CHECK(*popped >= previous);
+			previous = *popped;
+		}
+	}
+
+	//// Containers
+
+	void test_containers() {
+		pz::dynamic_array<int> array;
+		pz::segmented_array<int> segmented;
+		std::vector<int> expected;
+		for (int i = 0; i < 100000; ++i) {
+			const int value = int(gen());
+			array.push_back(value);
+			segmented.push_back(value);
+			expected.push_back(value);
+		}
+		CHECK(array.to_vector() == expected && segmented.to_vector() == expected);
+
+		// Everything written by one container reads back the same in another
+		std::vector<char> bytes;
+		{
+			pz::buffer_sink out(bytes);
+			array.serialize(out);
+		}
+		pz::buffer_source in_array(bytes), in_segmented(bytes), in_heap(bytes);
+		CHECK(pz::dynamic_array<int>::deserialize(in_array).to_vector() == expected);
+		CHECK(pz::segmented_array<int>::deserialize(in_segmented).to_vector() == expected);
+		auto heap_copy = pz::heap_array<int>::deserialize(in_heap);
+		CHECK(std::equal(heap_copy.begin(), heap_copy.end(), expected.begin(), expected.end()));
+
+		std::vector<std::string> words = make_strings(1000, 10, 26);
+		slist<std::string> list;
+		for (const auto& word : words)
+			list.append(word);
+		bytes.clear();
+		{
+			pz::buffer_sink out(bytes);
+			list.serialize(out);
+		}
+		pz::buffer_source in_words(bytes);
+		CHECK(pz::dynamic_array<std::string>::deserialize(in_words).to_vector() == words);
+
+		// Regression (user-024): heap_array indices are checked against its size
+		pz::heap_array<float, 64> aligned(10, 1.5f);
+		CHECK(aligned.sum() == 15.0f);
+		CHECK(throws<std::out_of_range>([&] { aligned[10]; }));
+
+		// Regression (user-021): counts that couldn't be stored in memory are rejected before allocating
+		const auto huge = bogus_header<std::uint64_t>((std::uint64_t(1) << 61) + 1);
+		CHECK(throws<std::runtime_error>([&] { pz::buffer_source in(huge); pz::dynamic_array<std::uint64_t>::deserialize(in); }));
+		CHECK(throws<std::runtime_error>([&] { pz::buffer_source in(huge); pz::vector_stack<std::uint64_t>::deserialize(in); }));
+		CHECK(throws<std::runtime_error>([&] { pz::buffer_source in(huge); pz::heap_array<std::uint64_t>::deserialize(in); }));
+		CHECK(throws<std::runtime_error>([&] { pz::buffer_source in(huge); bst<std::uint64_t> tree; tree.deserialize(in); }));
+		CHECK(throws<std::length_error>([] { pz::dynamic_array<std::uint64_t> too_big; too_big.reserve(std::size_t(1) << 61); }));
+
+		// Regression (user-023): a corrupt count ran segmented_array out of memory before reading anything
+		const auto long_count = bogus_header<std::uint64_t>(std::uint64_t(1) << 50);
+		CHECK(throws<std::runtime_error>([&] { pz::buffer_source in(long_count); pz::segmented_array<std::uint64_t>::deserialize(in); }));
+	}
+
+	void test_text() {
+		// Regression (user-021): write_text writes exactly what operator<< does
+		pz::dynamic_array<double> doubles;
+		for (const double value : { 1.0 / 3, 0.1, -0.0, 1e-5, 1234567.0, 1e300, std::numeric_limits<double>::infinity() })
+			doubles.push_back(value);
+		for (int i = 0; i < 1000; ++i)
+			doubles.push_back(double(std::int64_t(gen() % 2000000001) - 1000000000) / double(gen() % 100000 + 1));
+		CHECK(text_of(doubles) == stream_of(doubles));
+
+		pz::dynamic_array<bool> flags;
+		flags.push_back(true);
+		flags.push_back(false);
+		CHECK(text_of(flags) == "[1, 0]" && stream_of(flags) == "[1, 0]");
+
+		pz::segmented_array<unsigned char> chars;
+		chars.push_back('x');
+		chars.push_back('y');
+		CHECK(text_of(chars) == stream_of(chars));
+
+		pz::vector_stack<int> stack;
+		for (int value : { 3, -1, 2 })
+			stack.push(value);
+		CHECK(text_of(stack) == stream_of(stack));
+
+		// Regression (user-021): numbers reserved 32 bytes, so a caller buffer with just enough room for the text threw
+		char tiny[3];
+		pz::span_sink seven(tiny, sizeof(tiny));
+		pz::write_text_value(seven, 7);
+		CHECK(seven.size() == 1 && tiny[0] == '7');
+		const std::string expected = stream_of(doubles);
+		std::vector<char> exact(expected.size());
+		pz::span_sink fitted(exact.data(), exact.size());
+		doubles.write_text(fitted);
+		CHECK(fitted.size() == expected.size() && std::string(exact.begin(), exact.end()) == expected);
+		CHECK(throws<std::length_error>([&] { pz::span_sink full(exact.data(), exact.size() - 1); doubles.write_text(full); }));
+	}
+
+	void test_array_view() {
+		std::vector<int> values(7);
+		std::iota(values.begin(), values.end(), 0);
+		const pz::array_view<int> view(values);
+		CHECK(view.slice(2, 5).to_vector() == (std::vector<int>{ 2, 3, 4 }));
+		CHECK(view.reversed().slice(1, 3).to_vector() == (std::vector<int>{ 5, 4 }));
+		CHECK(view.strided(3).to_vector() == (std::vector<int>{ 0, 3, 6 }));
+		CHECK(throws<std::out_of_range>([&] { view.slice(3, 8); }));
+		CHECK(throws<std::invalid_argument>([&] { view.strided(0); }));
+
+		// Regression (user-022): empty slices at the end of reversed and strided views, and huge strides
+		CHECK(view.reversed().slice(7, 7).empty());
+		CHECK(view.strided(3).slice(3, 3).empty());
+		CHECK(view.strided(std::numeric_limits<std::size_t>::max()).to_vector() == std::vector<int>{ 0 });
+		CHECK(pz::array_view<int>().strided(5).empty());
+	}
+
+	void run(const char* name, void (*test)()) {
+		const int before = failures;
+		test();
+		std::printf("%-24s %s\n", name, failures == before ? "ok" : "FAILED");
+	}
+}
+
+int main() {
+	run("sorts", test_sorts);
+	run("string_sort", test_string_sort);
+	run("external_sort", test_external_sort);
+	run("selection", test_selection);
+	run("trees", test_trees);
+	run("frozen_search_tree", test_frozen_search_tree);
+	run("heaps", test_heaps);
+	run("containers", test_containers);
+	run("text", test_text);
+	run("array_view", test_array_view);
+	if (failures)
+		std::printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}